@@ -38,6 +38,8 @@
 
 #include "app.h"
 #include "light/logical_light.h"
+#include "light/color_loop.h"
+#include "light/light_trace.h"
 #include "mods/rz_button_press.h"
 
 #include "sl_dmp_ui_stub.h"
@@ -56,9 +58,13 @@ static bool identifying = false;
 // Forward declarations
 
 static void setDefaultReportEntry(void);
+#if defined(SL_CATALOG_ZIGBEE_LEVEL_CONTROL_PRESENT)
+static void applyOnOffAfterTransition(uint8_t endpoint);
+#endif // SL_CATALOG_ZIGBEE_LEVEL_CONTROL_PRESENT
 
 void emberAfMainTickCallback()
 {
+  llight_tick();
 }
 
 void dnjcButtonPressCb(uint8_t button, rz_button_press_status_t duration)
@@ -144,6 +150,7 @@ void emberAfMainInitCallback(void)
   #endif // SL_POWER_MANAGER_DEBUG == 1
   dnjcInit();
   rz_button_press_init();
+  llight_init();
 }
 
 /** @brief Start feedback.
@@ -206,6 +213,7 @@ void emberAfPostAttributeChangeCallback(uint8_t endpoint,
       TIMESTAMP_MS, endpoint, clusterId, attributeId, (uint8_t) *(value)
   );
   if ( mask != CLUSTER_MASK_SERVER ) return; // we only process server attributes
+  llight_attribute_changed(endpoint, clusterId, attributeId, value);
 
 #if !defined(SL_CATALOG_ZIGBEE_LEVEL_CONTROL_PRESENT)
   if (clusterId == ZCL_ON_OFF_CLUSTER_ID
@@ -236,26 +244,85 @@ void emberAfPostAttributeChangeCallback(uint8_t endpoint,
   if ( clusterId == ZCL_LEVEL_CONTROL_CLUSTER_ID
       && attributeId == ZCL_CURRENT_LEVEL_ATTRIBUTE_ID ) {
       llight_set_level( endpoint, value[0] );
-  } else if ( ZCL_LEVEL_CONTROL_REMAINING_TIME_ATTRIBUTE_ID == attributeId ) {
-    // Handle light state update depending on the remaining time attribute
-    uint8_t onOff;
-    if ( emberAfReadServerAttribute(endpoint,
-                                    ZCL_ON_OFF_CLUSTER_ID,
-                                    ZCL_ON_OFF_ATTRIBUTE_ID,
-                                    (uint8_t *) &onOff,
-                                    sizeof(onOff)) != EMBER_ZCL_STATUS_SUCCESS ) {
-      emberAfAppPrintln("Couldn't read current 'on/off' state: %s, forcing light off");
-      llight_turnoff_light(endpoint);
-      return;
-    }
-    if ( onOff || ( (value[0] == 0) && (value[1] == 0) ) ) {
-      emberAfOnOffClusterPrintln("Turning light %s on %d endpoint", (onOff ? "on" : "off"), endpoint);
-      llight_turnonoff_light(endpoint, onOff);
+  } else if ( clusterId == ZCL_ON_OFF_CLUSTER_ID
+             && attributeId == ZCL_ON_OFF_ATTRIBUTE_ID ) {
+    // Turning on is immediate, level control fades up from there. Turning off while
+    // level control fades down is done by the transition complete callback, or the
+    // cancel callback when another command interrupts the fade
+    if ( value[0] || !emberAfPluginLevelControlTransitionInProgress(endpoint) ) {
+      emberAfOnOffClusterPrintln("Turning light %s on %d endpoint", (value[0] ? "on" : "off"), endpoint);
+      llight_turnonoff_light(endpoint, value[0]);
     }
   }
 #endif
 }
 
+#if defined(SL_CATALOG_ZIGBEE_LEVEL_CONTROL_PRESENT)
+/** @brief Level Control transition start
+ *
+ * Called by the (patched) Level Control plugin when a transition starts. Channel
+ * endpoints are faded by the hardware when it can, level control then only updates
+ * CurrentLevel at a slow frame rate.
+ *
+ * @param endpoint The endpoint of the transition
+ * @param startLevel CurrentLevel at the start of the transition
+ * @param targetLevel Level at the end of the transition
+ * @param transitionTimeMs Transition time
+ * @return true if the output is faded by the hardware
+ */
+bool emberAfPluginLevelControlTransitionStartCallback(uint8_t endpoint,
+                                                      uint8_t startLevel,
+                                                      uint8_t targetLevel,
+                                                      uint32_t transitionTimeMs)
+{
+  (void) startLevel;
+  return llight_fade_start(endpoint, targetLevel, transitionTimeMs);
+}
+
+/** @brief Level Control transition complete
+ *
+ * Called by the (patched) Level Control plugin when a transition ends. Applies
+ * the OnOff state the light was waiting for, e.g. off at the end of a fade out.
+ *
+ * @param endpoint The endpoint of the finished transition
+ */
+void emberAfPluginLevelControlTransitionCompleteCallback(uint8_t endpoint)
+{
+  llight_fade_end(endpoint);
+  applyOnOffAfterTransition(endpoint);
+}
+
+/** @brief Level Control transition cancel
+ *
+ * Called by the (patched) Level Control plugin when a running transition is
+ * interrupted by Stop or a new command. A hardware fade is stopped where it is and
+ * an off the transition was holding back, e.g. Off during a fade, is applied now,
+ * the interrupting command never completes the old transition.
+ *
+ * @param endpoint The endpoint of the interrupted transition
+ */
+void emberAfPluginLevelControlTransitionCancelCallback(uint8_t endpoint)
+{
+  llight_fade_cancel(endpoint);
+  applyOnOffAfterTransition(endpoint);
+}
+
+/**
+ * Applies the OnOff state a transition kept the light from following, see the
+ * OnOff branch of emberAfPostAttributeChangeCallback().
+ */
+static void applyOnOffAfterTransition(uint8_t endpoint)
+{
+  uint8_t onOff;
+  if ( llight_get_onoff(endpoint, &onOff) != SL_STATUS_OK ) {
+    emberAfAppPrintln("Couldn't read current 'on/off' state, forcing light off");
+    llight_turnoff_light(endpoint);
+    return;
+  }
+  llight_turnonoff_light(endpoint, onOff);
+}
+#endif // SL_CATALOG_ZIGBEE_LEVEL_CONTROL_PRESENT
+
 /** @brief Pre Command Received
  *
  * This callback is the second in the Application Framework's message processing
@@ -269,6 +336,11 @@ void emberAfPostAttributeChangeCallback(uint8_t endpoint,
  */
 bool emberAfPreCommandReceivedCallback(EmberAfClusterCommand* cmd)
 {
+  LIGHT_TRACE(LIGHT_TRACE_EVT_COMMAND, cmd->apsFrame->destinationEndpoint, cmd->apsFrame->clusterId);
+  llight_command_received(cmd);
+  if (color_loop_command_received(cmd)) {
+    return true;
+  }
   if ((cmd->commandId == ZCL_ON_COMMAND_ID)
       || (cmd->commandId == ZCL_OFF_COMMAND_ID)
       || (cmd->commandId == ZCL_TOGGLE_COMMAND_ID)) {
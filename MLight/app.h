@@ -14,4 +14,13 @@
 #define CLUSTERS_TO_INIT_ON_OFF 4
 #define CLUSTERS_TO_INIT_LEVEL  4
 
+// Level Control plugin extensions, see patches/app/v4.4.5
+bool emberAfPluginLevelControlTransitionInProgress(uint8_t endpoint);
+void emberAfPluginLevelControlTransitionCompleteCallback(uint8_t endpoint);
+void emberAfPluginLevelControlTransitionCancelCallback(uint8_t endpoint);
+bool emberAfPluginLevelControlTransitionStartCallback(uint8_t endpoint,
+                                                      uint8_t startLevel,
+                                                      uint8_t targetLevel,
+                                                      uint32_t transitionTimeMs);
+
 #endif // _MAIN_APP_H
\ No newline at end of file
@@ -48,6 +48,8 @@
 #endif
 
 #include "app.h"
+#include "light/transition_stats.h"
+#include "light/light_trace.h"
 
 #ifdef ZCL_USING_LEVEL_CONTROL_CLUSTER_START_UP_CURRENT_LEVEL_ATTRIBUTE
 static bool areStartUpLevelControlServerAttributesTokenized(uint8_t endpoint);
@@ -59,6 +61,19 @@ static bool areStartUpLevelControlServerAttributesTokenized(uint8_t endpoint);
   #define FASTEST_TRANSITION_TIME_MS (MILLISECOND_TICKS_PER_SECOND / EMBER_AF_PLUGIN_LEVEL_CONTROL_RATE)
 #endif
 
+// Shortest interval between two level updates of a running transition. The level is
+// interpolated from the elapsed time, so a slower frame rate skips levels instead of
+// stretching the transition.
+#ifndef LEVEL_CONTROL_MIN_FRAME_MS
+#define LEVEL_CONTROL_MIN_FRAME_MS 20
+#endif
+
+// Frame interval while the application fades the output in hardware, the frames
+// then only keep CurrentLevel and RemainingTime reasonably fresh.
+#ifndef LEVEL_CONTROL_OUTPUT_FADE_FRAME_MS
+#define LEVEL_CONTROL_OUTPUT_FADE_FRAME_MS 250
+#endif
+
 #define INVALID_STORED_LEVEL 0xFFFF
 
 #define STARTUP_CURRENT_LEVEL_USE_DEVICE_MINIMUM 0x00
@@ -76,6 +91,15 @@ typedef struct {
   uint32_t elapsedTimeMs;
   uint32_t eventScheduledTimeMs;
   uint32_t eventStartTimeMs;
+  // sleeptimer tick count the transition started at. TIMESTAMP_MS wraps with the
+  // 32 bit tick counter, not at a power of two in ms, so only tick differences
+  // give the right elapsed time across the wrap.
+  uint32_t transitionStartTick;
+  uint32_t frameScheduledTick;
+  uint32_t frameDelayMs;
+  uint8_t startLevel;
+  bool inProgress;
+  bool outputFading;
 } EmberAfLevelControlState;
 
 static EmberAfLevelControlState stateTable[EMBER_AF_LEVEL_CONTROL_CLUSTER_SERVER_ENDPOINT_COUNT];
@@ -128,9 +152,145 @@ static void schedule(uint8_t endpoint, uint32_t delayMs)
                                               EMBER_AF_OK_TO_SLEEP);
 }
 
+// The application is told when a running transition is interrupted, by a Stop or a
+// new command, the output is left wherever the transition got to.
+SL_WEAK void emberAfPluginLevelControlTransitionCancelCallback(uint8_t endpoint)
+{
+  (void) endpoint;
+}
+
 static void deactivate(uint8_t endpoint)
 {
+  EmberAfLevelControlState *state = getState(endpoint);
   sl_zigbee_zcl_deactivate_server_tick(endpoint, ZCL_LEVEL_CONTROL_CLUSTER_ID);
+  if (state != NULL && state->inProgress) {
+    state->inProgress = false;
+    emberAfPluginLevelControlTransitionCancelCallback(endpoint);
+  }
+}
+
+// The application is told when a transition ends, either by reaching the target
+// level or an error, so it doesn't have to watch RemainingTime.
+SL_WEAK void emberAfPluginLevelControlTransitionCompleteCallback(uint8_t endpoint)
+{
+  (void) endpoint;
+}
+
+static void endTransition(uint8_t endpoint, EmberAfLevelControlState *state)
+{
+  state->inProgress = false;
+  emberAfPluginLevelControlTransitionCompleteCallback(endpoint);
+}
+
+bool emberAfPluginLevelControlTransitionInProgress(uint8_t endpoint)
+{
+  EmberAfLevelControlState *state = getState(endpoint);
+  return (state != NULL && state->inProgress);
+}
+
+// The application may fade the output itself, e.g. in hardware. Return true to take
+// the transition over, the level is then updated at LEVEL_CONTROL_OUTPUT_FADE_FRAME_MS.
+SL_WEAK bool emberAfPluginLevelControlTransitionStartCallback(uint8_t endpoint,
+                                                              uint8_t startLevel,
+                                                              uint8_t targetLevel,
+                                                              uint32_t transitionTimeMs)
+{
+  (void) endpoint;
+  (void) startLevel;
+  (void) targetLevel;
+  (void) transitionTimeMs;
+  return false;
+}
+
+static uint32_t minFrameMs(const EmberAfLevelControlState *state)
+{
+  return (state->outputFading
+          ? LEVEL_CONTROL_OUTPUT_FADE_FRAME_MS
+          : LEVEL_CONTROL_MIN_FRAME_MS);
+}
+
+// ms since a sleeptimer tick count
+static uint32_t msSinceTick(uint32_t tick)
+{
+  return sl_sleeptimer_tick_to_ms(sl_sleeptimer_get_tick_count() - tick);
+}
+
+static void scheduleFrame(uint8_t endpoint,
+                          EmberAfLevelControlState *state,
+                          uint32_t delayMs)
+{
+  state->frameScheduledTick = sl_sleeptimer_get_tick_count();
+  state->frameDelayMs = delayMs;
+  schedule(endpoint, delayMs);
+}
+
+static void startTransition(uint8_t endpoint,
+                            EmberAfLevelControlState *state,
+                            uint8_t currentLevel)
+{
+  state->startLevel = currentLevel;
+  state->transitionStartTick = sl_sleeptimer_get_tick_count();
+  state->inProgress = true;
+  state->elapsedTimeMs = 0;
+  state->outputFading = emberAfPluginLevelControlTransitionStartCallback(endpoint,
+                                                                         currentLevel,
+                                                                         state->moveToLevel,
+                                                                         state->transitionTimeMs);
+  // first frame is one level step away, but no sooner than the frame rate allows
+  uint32_t delayMs = state->eventDurationMs;
+  if (delayMs < minFrameMs(state)) {
+    delayMs = minFrameMs(state);
+  }
+  if (delayMs > state->transitionTimeMs) {
+    delayMs = state->transitionTimeMs;
+  }
+  transition_stats_start(endpoint);
+  scheduleFrame(endpoint, state, delayMs);
+}
+
+// Level on the way from startLevel to moveToLevel after elapsedMs. Rounds towards
+// the start level, so the target is only reached once the transition time is up.
+static uint8_t levelAtElapsedTime(const EmberAfLevelControlState *state,
+                                  uint32_t elapsedMs)
+{
+  if (elapsedMs >= state->transitionTimeMs) {
+    return state->moveToLevel;
+  }
+
+  uint32_t distance = (state->increasing
+                       ? state->moveToLevel - state->startLevel
+                       : state->startLevel - state->moveToLevel);
+  uint32_t travelled = distance * elapsedMs / state->transitionTimeMs;
+
+  return (uint8_t) (state->increasing
+                    ? state->startLevel + travelled
+                    : state->startLevel - travelled);
+}
+
+// Delay until the level moves by the next step, capped by the frame rate and never
+// past the end of the transition.
+static uint32_t nextFrameDelayMs(const EmberAfLevelControlState *state,
+                                 uint8_t currentLevel,
+                                 uint32_t elapsedMs)
+{
+  uint32_t distance = (state->increasing
+                       ? state->moveToLevel - state->startLevel
+                       : state->startLevel - state->moveToLevel);
+  uint32_t travelled = (state->increasing
+                        ? currentLevel - state->startLevel
+                        : state->startLevel - currentLevel);
+  // first ms at which levelAtElapsedTime() returns the next level
+  uint32_t nextStepMs = ((travelled + 1) * state->transitionTimeMs + distance - 1)
+                        / distance;
+  uint32_t remainingMs = (elapsedMs < state->transitionTimeMs
+                          ? state->transitionTimeMs - elapsedMs
+                          : 0);
+  uint32_t delayMs = (nextStepMs > elapsedMs ? nextStepMs - elapsedMs : 0);
+
+  if (delayMs < minFrameMs(state)) {
+    delayMs = minFrameMs(state);
+  }
+  return (delayMs < remainingMs ? delayMs : remainingMs);
 }
 
 static EmberAfLevelControlState *getState(uint8_t endpoint)
@@ -174,7 +334,12 @@ void emberAfLevelControlClusterServerTickCallback(uint8_t endpoint)
 
   if ( state->eventStartTimeMs == 0 ) state->eventStartTimeMs = TIMESTAMP_MS;
 
-  state->elapsedTimeMs += state->eventDurationMs;
+  state->elapsedTimeMs = msSinceTick(state->transitionStartTick);
+  uint32_t sinceScheduledMs = msSinceTick(state->frameScheduledTick);
+  transition_stats_record_tick(endpoint,
+                               (sinceScheduledMs > state->frameDelayMs
+                                ? sinceScheduledMs - state->frameDelayMs
+                                : 0));
 
 #if !defined(ZCL_USING_LEVEL_CONTROL_CLUSTER_OPTIONS_ATTRIBUTE) \
   && defined(SL_CATALOG_ZIGBEE_ZLL_LEVEL_CONTROL_SERVER_PRESENT)
@@ -193,24 +358,28 @@ void emberAfLevelControlClusterServerTickCallback(uint8_t endpoint)
   if (status != EMBER_ZCL_STATUS_SUCCESS) {
     emberAfLevelControlClusterPrintln("ERR: reading current level %x", status);
     writeRemainingTime(endpoint, 0);
+    endTransition(endpoint, state);
     return;
   }
 
   //emberAfLevelControlClusterPrint("Event: move from %d", currentLevel);
 
-  // adjust by the proper amount, either up or down
-  if (state->transitionTimeMs == 0) {
-    // Immediate, not over a time interval.
-    currentLevel = state->moveToLevel;
-  } else if (state->increasing) {
-    assert(currentLevel < MAX_LEVEL);
-    assert(currentLevel < state->moveToLevel);
-    currentLevel++;
-  } else {
-    assert(MIN_LEVEL < currentLevel);
-    assert(state->moveToLevel < currentLevel);
-    currentLevel--;
+  // interpolate from the wall clock time, late ticks catch up instead of
+  // accumulating the scheduling lag
+  uint8_t newLevel = levelAtElapsedTime(state, state->elapsedTimeMs);
+  LIGHT_TRACE(LIGHT_TRACE_EVT_FRAME, endpoint, newLevel);
+  // CurrentLevel may already hold the target when it was written from outside
+  // the transition, a frame at the target always completes it
+  if (newLevel == currentLevel
+      && newLevel != state->moveToLevel
+      && state->elapsedTimeMs < state->transitionTimeMs) {
+    // nothing to render in this frame, wait for the next level step
+    writeRemainingTime(endpoint,
+                       state->transitionTimeMs - state->elapsedTimeMs);
+    scheduleFrame(endpoint, state, nextFrameDelayMs(state, currentLevel, state->elapsedTimeMs));
+    return;
   }
+  currentLevel = newLevel;
 
   //emberAfLevelControlClusterPrint(" to %d ", currentLevel);
   //emberAfLevelControlClusterPrintln("(diff %c1)",
@@ -224,6 +393,7 @@ void emberAfLevelControlClusterServerTickCallback(uint8_t endpoint)
   if (status != EMBER_ZCL_STATUS_SUCCESS) {
     emberAfLevelControlClusterPrintln("ERR: writing current level %x", status);
     writeRemainingTime(endpoint, 0);
+    endTransition(endpoint, state);
     return;
   }
 
@@ -236,6 +406,11 @@ void emberAfLevelControlClusterServerTickCallback(uint8_t endpoint)
 
   // Are we at the requested level?
   if (currentLevel == state->moveToLevel) {
+    // no longer in progress, so OnOff changes from below take effect right away
+    state->inProgress = false;
+    transition_stats_record_transition(endpoint,
+                                       state->transitionTimeMs,
+                                       state->elapsedTimeMs);
     uint32_t delta = TIMESTAMP_MS - state->eventStartTimeMs;
     emberAfLevelControlClusterPrintln("Event: move completed in %d ms, 1st event schedule lag: %d, scheduled transition time: %d",
         delta, state->eventScheduledTimeMs - state->eventStartTimeMs, state->transitionTimeMs);
@@ -276,10 +451,11 @@ void emberAfLevelControlClusterServerTickCallback(uint8_t endpoint)
     delta = TIMESTAMP_MS - state->eventStartTimeMs;
     emberAfLevelControlClusterPrintln("Event: move completed in %d ms, 1st event schedule lag: %d, scheduled transition time: %d",
         delta, state->eventScheduledTimeMs - state->eventStartTimeMs, state->transitionTimeMs);
+    endTransition(endpoint, state);
   } else {
     writeRemainingTime(endpoint,
                        state->transitionTimeMs - state->elapsedTimeMs);
-    schedule(endpoint, state->eventDurationMs);
+    scheduleFrame(endpoint, state, nextFrameDelayMs(state, currentLevel, state->elapsedTimeMs));
   }
 }
 
@@ -678,7 +854,7 @@ static void moveToLevelHandler(uint8_t endpoint,
   state->storedLevel = storedLevel;
 
   // The setup was successful, so mark the new state as active and return.
-  schedule(endpoint, state->eventDurationMs);
+  startTransition(endpoint, state, currentLevel);
   emberAfLevelControlClusterPrintln("Lvl Ctl: Move to %d over %d ds, event duration %d ms",
                                     state->moveToLevel,
                                     transitionTimeDs,
@@ -799,7 +975,7 @@ static void moveHandler(uint8_t commandId, uint8_t moveMode, uint8_t rate, uint8
   state->useOnLevel = false;
 
   // The setup was successful, so mark the new state as active and return.
-  schedule(endpoint, state->eventDurationMs);
+  startTransition(endpoint, state, currentLevel);
   status = EMBER_ZCL_STATUS_SUCCESS;
 
   send_default_response:
@@ -913,7 +1089,7 @@ static void stepHandler(uint8_t commandId,
   state->useOnLevel = false;
 
   // The setup was successful, so mark the new state as active and return.
-  schedule(endpoint, state->eventDurationMs);
+  startTransition(endpoint, state, currentLevel);
   status = EMBER_ZCL_STATUS_SUCCESS;
 
   send_default_response:
@@ -938,7 +1114,7 @@ static void stopHandler(uint8_t commandId,
     goto send_default_response;
   }
 
-  // Cancel any currently active command.
+  // Cancel any currently active command, which reports the interrupted transition.
   deactivate(endpoint);
   writeRemainingTime(endpoint, 0);
   status = EMBER_ZCL_STATUS_SUCCESS;
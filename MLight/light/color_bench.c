@@ -0,0 +1,42 @@
+#include "af.h"
+#ifdef SL_COMPONENT_CATALOG_PRESENT
+#include "sl_component_catalog.h"
+#endif // SL_COMPONENT_CATALOG_PRESENT
+
+#ifdef SL_CATALOG_CLI_PRESENT
+#include "em_core.h"
+#include "em_device.h"
+#include "sl_cli.h"
+#include "sl_zigbee_debug_print.h"
+
+#include "color_conv.h"
+
+static uint32_t _cycle_count(void)
+{
+    return DWT->CYCCNT;
+}
+
+/***************************************************************************//**
+ * Command Line Interface callback, times the color conversion matrix kernels on
+ * the DWT cycle counter and prints the cycles per conversion, loop included
+ *
+ * @param[in] arguments command line argument list
+ ******************************************************************************/
+void color_bench_from_cli(sl_cli_command_arg_t *arguments)
+{
+    color_conv_benchmark_t result;
+    (void) arguments;
+
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    color_conv_benchmark( _cycle_count, &result );
+    CORE_EXIT_ATOMIC();
+
+    sl_zigbee_app_debug_println("Color kernels, packed on %s, cycles per conversion:", result.backend);
+    sl_zigbee_app_debug_println("  XYZ -> RGB wide/packed: %d/%d", result.xyz_to_rgb_wide, result.xyz_to_rgb_packed);
+    sl_zigbee_app_debug_println("  RGB -> XYZ wide/packed: %d/%d", result.rgb_to_xyz_wide, result.rgb_to_xyz_packed);
+}
+#endif // SL_CATALOG_CLI_PRESENT
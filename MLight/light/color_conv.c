@@ -0,0 +1,327 @@
+#include "color_conv.h"
+#include "gamma.h"
+#include "hw_light_color_calibration.h"
+#include "planck_tables.h"
+
+#ifndef COLOR_CONV_SIMD
+#define COLOR_CONV_SIMD         1
+#endif // COLOR_CONV_SIMD
+
+#if COLOR_CONV_SIMD && defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "cmsis_compiler.h"
+#define COLOR_CONV_BACKEND      "SMLAD"
+#else
+#define COLOR_CONV_BACKEND      "C"
+#endif
+
+#define Q16_ONE                 (1L << 16)
+
+// ZCL CurrentSaturation of a fully saturated color
+#define HSV_MAX_SATURATION      254
+// ceil(2^31 / HSV_MAX_SATURATION), (saturation * it) >> 15 is the same as
+// (saturation << 16) / HSV_MAX_SATURATION over the whole saturation range
+#define HSV_SATURATION_RECIPROCAL   8454661UL
+#define HSV_SATURATION_SHIFT        15
+
+// the dual MAC kernels take XYZ as Q14 and linear RGB as Q15, both fit int16 lanes
+#define DUAL_XYZ_LIMIT          (2UL << 16)
+#define DUAL_XYZ_SHIFT          (HW_LIGHT_XYZ_TO_RGB_DUAL_Q + 14 - 16)
+#define DUAL_RGB_SHIFT          (32 - 15 - HW_LIGHT_RGB_TO_XYZ_DUAL_Q)
+
+#if (DUAL_XYZ_SHIFT < 1) || (DUAL_RGB_SHIFT < 0)
+#error "Calibration matrices need regenerating with tools/gen_color_matrix.py"
+#endif
+
+#define MIN(a, b) ( (a) < (b) ? (a) : (b) )
+#define CLAMP(v, lo, hi) ( (v) < (lo) ? (lo) : MIN(v, hi) )
+
+// XYZ -> linear RGB in Q16, generated from the calibration of the board
+static const int32_t _xyz_to_rgb[3][3] = HW_LIGHT_XYZ_TO_RGB;
+
+// linear RGB -> XYZ in Q16, inverse of the above
+static const uint32_t _rgb_to_xyz[3][3] = HW_LIGHT_RGB_TO_XYZ;
+
+// same matrices packed for the dual MAC, two int16 coefficients per word
+static const uint32_t _xyz_to_rgb_dual[3][2] = HW_LIGHT_XYZ_TO_RGB_DUAL;
+static const uint32_t _rgb_to_xyz_dual[3][2] = HW_LIGHT_RGB_TO_XYZ_DUAL;
+
+static void _xyz_to_rgb_wide(const uint32_t xyz[3], int32_t rgb[3]);
+static bool _xyz_to_rgb_packed(const uint32_t xyz[3], int32_t rgb[3]);
+static void _rgb_to_xyz_wide(const uint32_t rgb[3], uint64_t xyz[3]);
+static void _rgb_to_xyz_packed(const uint32_t rgb[3], uint64_t xyz[3]);
+
+/**
+ * @brief calculate gamma encoded RGB from CIE xy chromaticity, normalized to brightness
+ * @param[in] color_x -- ZCL CurrentX attribute value (x * 65535)
+ * @param[in] color_y -- ZCL CurrentY attribute value (y * 65535)
+ * @param[in] level -- ZCL CurrentLevel attribute value, used as the luminance
+ * @param[out] red, green, blue -- channel intensities [0-65535]
+ */
+void color_conv_xy_to_rgb(uint16_t color_x, uint16_t color_y, uint8_t level,
+                          uint16_t *red, uint16_t *green, uint16_t *blue)
+{
+    (void) color_conv_xy_to_rgb_in_gamut( color_x, color_y, level, red, green, blue );
+}
+
+/**
+ * @brief same as color_conv_xy_to_rgb(), also tells if the color is reproducible
+ * @return false if a channel had to be clipped, the output is then off the chromaticity
+ */
+bool color_conv_xy_to_rgb_in_gamut(uint16_t color_x, uint16_t color_y, uint8_t level,
+                                   uint16_t *red, uint16_t *green, uint16_t *blue)
+{
+    uint16_t *out[3] = { red, green, blue };
+    uint32_t xyz[3];
+    int32_t linear[3];
+    bool in_gamut = true;
+
+    // Y = level / 255 in Q16, X = Y / y * x, Z = Y / y * (1 - x - y)
+    uint32_t Y = ((uint32_t) level * Q16_ONE + 127) / 255;
+    uint32_t y = color_y ? color_y : 1;
+    int32_t z = 0xFFFF - (int32_t) color_x - (int32_t) color_y;
+    if ( z < 0 ) z = 0;
+
+    // X and Z get large for small y, but Y * x still fits 32 bits and the matrix is done in 64
+    xyz[0] = (Y * color_x) / y;
+    xyz[1] = Y;
+    xyz[2] = (Y * (uint32_t) z) / y;
+
+    // the packed kernel covers everything up to X, Z of 2.0, beyond that the color is far out of gamut
+    if ( !_xyz_to_rgb_packed( xyz, linear ) ) _xyz_to_rgb_wide( xyz, linear );
+
+    for ( uint8_t ch = 0; ch < 3; ch++ ) {
+        in_gamut &= ( linear[ch] >= 0 ) && ( linear[ch] <= Q16_ONE );
+
+        // same as the float path, gamma encoded value is scaled by the luminance once more
+        uint32_t encoded = gamma_encode( (uint32_t) CLAMP( linear[ch], 0, Q16_ONE ) );
+        *(out[ch]) = (uint16_t) ((encoded * level + 127) / 255);
+    }
+    return in_gamut;
+}
+
+/**
+ * @brief calculate CIE xy chromaticity and luminance level from gamma encoded RGB
+ * @param[in] red, green, blue -- channel levels [0-255]
+ * @param[out] color_x -- ZCL CurrentX attribute value (x * 65535)
+ * @param[out] color_y -- ZCL CurrentY attribute value (y * 65535)
+ * @param[out] level -- luminance as ZCL CurrentLevel
+ * @return false if all channels are off and the chromaticity is undefined,
+ *         color_x and color_y are left untouched in this case
+ */
+bool color_conv_rgb_to_xy(uint8_t red, uint8_t green, uint8_t blue,
+                          uint16_t *color_x, uint16_t *color_y, uint8_t *level)
+{
+    uint32_t rgb[3] = { gamma_decode( red ), gamma_decode( green ), gamma_decode( blue ) };
+    uint64_t xyz[3];
+
+    _rgb_to_xyz_packed( rgb, xyz );
+
+    *level = (uint8_t) ((xyz[1] * 255 + (0xFFFFULL << 15)) / (0xFFFFULL << 16));
+
+    uint64_t sum = xyz[0] + xyz[1] + xyz[2];
+    if ( 0 == sum ) return false;
+
+    // scale down to 16 bits, so the divisions below stay 32 bit
+    uint8_t shift = 0;
+    while ( (sum >> shift) > 0xFFFF ) shift++;
+    uint32_t sum16 = (uint32_t) (sum >> shift);
+
+    *color_x = (uint16_t) (((uint32_t) (xyz[0] >> shift) * 0xFFFF + (sum16 >> 1)) / sum16);
+    *color_y = (uint16_t) (((uint32_t) (xyz[1] >> shift) * 0xFFFF + (sum16 >> 1)) / sum16);
+    return true;
+}
+
+/**
+ * @brief calculate gamma encoded RGB from hue, saturation and value, sextant math
+ *        in Q16 without any division at run time
+ * @param[in] hue -- ZCL EnhancedCurrentHue attribute value, 0x10000 == 360 degrees
+ * @param[in] saturation -- ZCL CurrentSaturation attribute value [0-254]
+ * @param[in] level -- ZCL CurrentLevel attribute value, used as the value
+ * @param[out] red, green, blue -- channel intensities [0-65535]
+ */
+void color_conv_hsv_to_rgb(uint16_t hue, uint8_t saturation, uint8_t level,
+                           uint16_t *red, uint16_t *green, uint16_t *blue)
+{
+    uint32_t v = (uint32_t) level * 0x101;
+    uint32_t s = ((uint32_t) MIN( saturation, HSV_MAX_SATURATION ) * HSV_SATURATION_RECIPROCAL)
+                 >> HSV_SATURATION_SHIFT;
+    uint32_t h6 = (uint32_t) hue * 6;
+    uint32_t sf = (s * (h6 & 0xFFFF)) >> 16;
+
+    // v * (1 - s), v * (1 - s * f) and v * (1 - s * (1 - f)), with f the position in the sextant
+    uint16_t p = (uint16_t) ((v * (Q16_ONE - s)) >> 16);
+    uint16_t q = (uint16_t) ((v * (Q16_ONE - sf)) >> 16);
+    uint16_t t = (uint16_t) ((v * (Q16_ONE - s + sf)) >> 16);
+
+    switch ( h6 >> 16 ) {
+        case 0:  *red = (uint16_t) v; *green = t; *blue = p; break;
+        case 1:  *red = q; *green = (uint16_t) v; *blue = p; break;
+        case 2:  *red = p; *green = (uint16_t) v; *blue = t; break;
+        case 3:  *red = p; *green = q; *blue = (uint16_t) v; break;
+        case 4:  *red = t; *green = p; *blue = (uint16_t) v; break;
+        default: *red = (uint16_t) v; *green = p; *blue = q; break;
+    }
+}
+
+/**
+ * @brief CIE xy chromaticity of a color temperature, on the Planckian locus
+ * @param[in] mireds -- ZCL ColorTemperatureMireds, clamped to [PLANCK_MIREDS_MIN-PLANCK_MIREDS_MAX]
+ * @param[out] color_x -- ZCL CurrentX attribute value (x * 65535)
+ * @param[out] color_y -- ZCL CurrentY attribute value (y * 65535)
+ */
+void color_conv_mireds_to_xy(uint16_t mireds, uint16_t *color_x, uint16_t *color_y)
+{
+    uint16_t offset = (uint16_t) CLAMP( mireds, PLANCK_MIREDS_MIN, PLANCK_MIREDS_MAX ) - PLANCK_MIREDS_MIN;
+    uint8_t i = (uint8_t) (offset >> PLANCK_STEP_SHIFT);
+    int32_t fraction = offset & ((1 << PLANCK_STEP_SHIFT) - 1);
+
+    *color_x = planck_locus_x[i];
+    *color_y = planck_locus_y[i];
+    // the last entry is only ever hit exactly
+    if ( 0 == fraction ) return;
+
+    *color_x += (uint16_t) ( (((int32_t) planck_locus_x[i + 1] - planck_locus_x[i]) * fraction) >> PLANCK_STEP_SHIFT );
+    *color_y += (uint16_t) ( (((int32_t) planck_locus_y[i + 1] - planck_locus_y[i]) * fraction) >> PLANCK_STEP_SHIFT );
+}
+
+/**
+ * @brief time the matrix kernels, the wide 64-bit ones against the dual MAC ones
+ * @param[in] counter -- free running cycle counter
+ * @param[out] result -- average cycles per 3x3 conversion of each kernel
+ */
+void color_conv_benchmark(uint32_t (*counter)(void), color_conv_benchmark_t *result)
+{
+    uint32_t in[COLOR_CONV_BENCHMARK_ROUNDS][3];
+    uint64_t xyz[3];
+    int32_t rgb[3];
+    volatile int64_t sink = 0;
+    uint32_t start;
+
+    // colors spread over the gamut, the XYZ inputs stay in the packed range
+    for ( uint16_t i = 0; i < COLOR_CONV_BENCHMARK_ROUNDS; i++ ) {
+        in[i][0] = (i * 2053UL) & 0xFFFF;
+        in[i][1] = (i * 4099UL + 0x4000) & 0xFFFF;
+        in[i][2] = (i * 8209UL + 0x8000) & 0xFFFF;
+    }
+
+    start = counter();
+    for ( uint16_t i = 0; i < COLOR_CONV_BENCHMARK_ROUNDS; i++ ) {
+        _xyz_to_rgb_wide( in[i], rgb );
+        sink += rgb[0] + rgb[1] + rgb[2];
+    }
+    result->xyz_to_rgb_wide = (counter() - start) / COLOR_CONV_BENCHMARK_ROUNDS;
+
+    start = counter();
+    for ( uint16_t i = 0; i < COLOR_CONV_BENCHMARK_ROUNDS; i++ ) {
+        (void) _xyz_to_rgb_packed( in[i], rgb );
+        sink += rgb[0] + rgb[1] + rgb[2];
+    }
+    result->xyz_to_rgb_packed = (counter() - start) / COLOR_CONV_BENCHMARK_ROUNDS;
+
+    start = counter();
+    for ( uint16_t i = 0; i < COLOR_CONV_BENCHMARK_ROUNDS; i++ ) {
+        _rgb_to_xyz_wide( in[i], xyz );
+        sink += (int64_t) (xyz[0] + xyz[1] + xyz[2]);
+    }
+    result->rgb_to_xyz_wide = (counter() - start) / COLOR_CONV_BENCHMARK_ROUNDS;
+
+    start = counter();
+    for ( uint16_t i = 0; i < COLOR_CONV_BENCHMARK_ROUNDS; i++ ) {
+        _rgb_to_xyz_packed( in[i], xyz );
+        sink += (int64_t) (xyz[0] + xyz[1] + xyz[2]);
+    }
+    result->rgb_to_xyz_packed = (counter() - start) / COLOR_CONV_BENCHMARK_ROUNDS;
+
+    result->backend = COLOR_CONV_BACKEND;
+    (void) sink;
+}
+
+// *****************************
+// internal method implementations
+// -----------------------------
+#if COLOR_CONV_SIMD && defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+static inline int32_t _smuad(uint32_t x, uint32_t y)
+{
+    return (int32_t) __SMUAD( x, y );
+}
+
+static inline int32_t _smlad(uint32_t x, uint32_t y, int32_t acc)
+{
+    return (int32_t) __SMLAD( x, y, (uint32_t) acc );
+}
+#else
+// bit exact equivalents of the DSP instructions, host builds get the same results as the target
+static inline int32_t _smuad(uint32_t x, uint32_t y)
+{
+    return (int32_t) (int16_t) x * (int16_t) y
+           + (int32_t) (int16_t) (x >> 16) * (int16_t) (y >> 16);
+}
+
+static inline int32_t _smlad(uint32_t x, uint32_t y, int32_t acc)
+{
+    return (int32_t) ((uint32_t) acc + (uint32_t) _smuad( x, y ));
+}
+#endif
+
+/**
+ * @brief XYZ -> linear RGB with full 64-bit products, takes any input
+ * @param[in] xyz -- Q16
+ * @param[out] rgb -- Q16, saturated to the int32 range
+ */
+static void _xyz_to_rgb_wide(const uint32_t xyz[3], int32_t rgb[3])
+{
+    for ( uint8_t ch = 0; ch < 3; ch++ ) {
+        int64_t acc = (int64_t) xyz[0] * _xyz_to_rgb[ch][0]
+                      + (int64_t) xyz[1] * _xyz_to_rgb[ch][1]
+                      + (int64_t) xyz[2] * _xyz_to_rgb[ch][2];
+        rgb[ch] = (int32_t) CLAMP( acc >> 16, INT32_MIN, INT32_MAX );
+    }
+}
+
+/**
+ * @brief XYZ -> linear RGB with two 16-bit MACs per row, XYZ is cut down to Q14
+ * @param[in] xyz -- Q16
+ * @param[out] rgb -- Q16, untouched if an input doesn't fit
+ * @return false if an input is 2.0 or above and needs the wide kernel
+ */
+static bool _xyz_to_rgb_packed(const uint32_t xyz[3], int32_t rgb[3])
+{
+    if ( (xyz[0] | xyz[1] | xyz[2]) >= DUAL_XYZ_LIMIT ) return false;
+
+    uint32_t xy = (xyz[0] >> 2) | ((xyz[1] >> 2) << 16);
+    uint32_t z = xyz[2] >> 2;
+    for ( uint8_t ch = 0; ch < 3; ch++ ) {
+        int32_t acc = _smlad( z, _xyz_to_rgb_dual[ch][1], _smuad( xy, _xyz_to_rgb_dual[ch][0] ) );
+        rgb[ch] = (acc + (1L << (DUAL_XYZ_SHIFT - 1))) >> DUAL_XYZ_SHIFT;
+    }
+    return true;
+}
+
+/**
+ * @brief linear RGB -> XYZ with full 64-bit products
+ * @param[in] rgb -- Q16, up to 0xFFFF
+ * @param[out] xyz -- Q32
+ */
+static void _rgb_to_xyz_wide(const uint32_t rgb[3], uint64_t xyz[3])
+{
+    for ( uint8_t i = 0; i < 3; i++ ) {
+        xyz[i] = (uint64_t) rgb[0] * _rgb_to_xyz[i][0]
+                 + (uint64_t) rgb[1] * _rgb_to_xyz[i][1]
+                 + (uint64_t) rgb[2] * _rgb_to_xyz[i][2];
+    }
+}
+
+/**
+ * @brief linear RGB -> XYZ with two 16-bit MACs per row, RGB is cut down to Q15
+ * @param[in] rgb -- Q16, up to 0xFFFF
+ * @param[out] xyz -- Q32, the low bits are zero
+ */
+static void _rgb_to_xyz_packed(const uint32_t rgb[3], uint64_t xyz[3])
+{
+    uint32_t rg = (rgb[0] >> 1) | ((rgb[1] >> 1) << 16);
+    uint32_t b = rgb[2] >> 1;
+    for ( uint8_t i = 0; i < 3; i++ ) {
+        int32_t acc = _smlad( b, _rgb_to_xyz_dual[i][1], _smuad( rg, _rgb_to_xyz_dual[i][0] ) );
+        xyz[i] = (uint64_t) (uint32_t) acc << DUAL_RGB_SHIFT;
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef _COLOR_CONV_H_
+#define _COLOR_CONV_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// inputs run through every kernel by color_conv_benchmark()
+#define COLOR_CONV_BENCHMARK_ROUNDS 32
+
+typedef struct {
+    const char *backend;            // "SMLAD" or "C", what the packed kernels run on
+    uint32_t xyz_to_rgb_wide;       // cycles per conversion
+    uint32_t xyz_to_rgb_packed;
+    uint32_t rgb_to_xyz_wide;
+    uint32_t rgb_to_xyz_packed;
+} color_conv_benchmark_t;
+
+/**
+ * Fixed point color conversion kernels used by the logical light.
+ *
+ * All the math is done in integers: chromaticity and linear light values are
+ * carried as Q16 (1.0 == 0x10000), the XYZ -> linear RGB matrix is stored as
+ * Q16 signed coefficients and accumulated in 64 bits, and the sRGB transfer
+ * function in both directions comes from the gamma module tables. Both
+ * matrices come from hw_light_color_calibration.h, generated per board by
+ * tools/gen_color_matrix.py from the measured LED primaries.
+ *
+ * The 3x3 matrix products run on packed 16-bit coefficients, two multiply
+ * accumulates per instruction with SMUAD/SMLAD on cores with the DSP extension
+ * (Cortex-M4F of the EFR32MG12, Cortex-M33 of the EFR32MG21) and a bit exact
+ * C equivalent elsewhere, so host builds give the same results. XYZ inputs of
+ * 2.0 and above fall back to the 64-bit kernel. Building with COLOR_CONV_SIMD
+ * set to 0 forces the C equivalent on the target too.
+ *
+ * Error against the float/pow() path it replaced, from tools/color_conv_bench.py:
+ * x and y in steps of 256 (x from 0, y from 256, x + y <= 65535) and every level
+ * 0..255, 8355840 conversions with the sRGB calibration all the templates ship.
+ * The worst channel error is 231/65535 (0.35% of full scale, under 1 LSB of an
+ * 8-bit channel) and 44.4% of the outputs are bit exact. The error comes from the
+ * Q13 packed coefficients and the interpolated gamma table where the curve is
+ * steepest.
+ */
+
+/**
+ * @brief calculate gamma encoded RGB from CIE xy chromaticity, normalized to brightness
+ * @param[in] color_x -- ZCL CurrentX attribute value (x * 65535)
+ * @param[in] color_y -- ZCL CurrentY attribute value (y * 65535)
+ * @param[in] level -- ZCL CurrentLevel attribute value, used as the luminance
+ * @param[out] red, green, blue -- channel intensities [0-65535]
+ */
+void color_conv_xy_to_rgb(uint16_t color_x, uint16_t color_y, uint8_t level,
+                          uint16_t *red, uint16_t *green, uint16_t *blue);
+
+/**
+ * @brief same as color_conv_xy_to_rgb(), also tells if the color is reproducible
+ * @return false if a channel had to be clipped, the output is then off the chromaticity
+ */
+bool color_conv_xy_to_rgb_in_gamut(uint16_t color_x, uint16_t color_y, uint8_t level,
+                                   uint16_t *red, uint16_t *green, uint16_t *blue);
+
+/**
+ * @brief calculate CIE xy chromaticity and luminance level from gamma encoded RGB
+ * @param[in] red, green, blue -- channel levels [0-255]
+ * @param[out] color_x -- ZCL CurrentX attribute value (x * 65535)
+ * @param[out] color_y -- ZCL CurrentY attribute value (y * 65535)
+ * @param[out] level -- luminance as ZCL CurrentLevel
+ * @return false if all channels are off and the chromaticity is undefined,
+ *         color_x and color_y are left untouched in this case
+ */
+bool color_conv_rgb_to_xy(uint8_t red, uint8_t green, uint8_t blue,
+                          uint16_t *color_x, uint16_t *color_y, uint8_t *level);
+
+/**
+ * @brief calculate gamma encoded RGB from hue, saturation and value, sextant math
+ *        in Q16 without any division at run time
+ * @param[in] hue -- ZCL EnhancedCurrentHue attribute value, 0x10000 == 360 degrees
+ * @param[in] saturation -- ZCL CurrentSaturation attribute value [0-254]
+ * @param[in] level -- ZCL CurrentLevel attribute value, used as the value
+ * @param[out] red, green, blue -- channel intensities [0-65535]
+ */
+void color_conv_hsv_to_rgb(uint16_t hue, uint8_t saturation, uint8_t level,
+                           uint16_t *red, uint16_t *green, uint16_t *blue);
+
+/**
+ * @brief CIE xy chromaticity of a color temperature, on the Planckian locus
+ * @param[in] mireds -- ZCL ColorTemperatureMireds, clamped to [PLANCK_MIREDS_MIN-PLANCK_MIREDS_MAX]
+ * @param[out] color_x -- ZCL CurrentX attribute value (x * 65535)
+ * @param[out] color_y -- ZCL CurrentY attribute value (y * 65535)
+ */
+void color_conv_mireds_to_xy(uint16_t mireds, uint16_t *color_x, uint16_t *color_y);
+
+/**
+ * @brief time the matrix kernels, the wide 64-bit ones against the dual MAC ones
+ * @param[in] counter -- free running cycle counter
+ * @param[out] result -- average cycles per 3x3 conversion of each kernel
+ */
+void color_conv_benchmark(uint32_t (*counter)(void), color_conv_benchmark_t *result);
+
+#endif // _COLOR_CONV_H_
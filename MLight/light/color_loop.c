@@ -0,0 +1,322 @@
+#include "af.h"
+#include "sl_sleeptimer.h"
+
+#include "color_loop.h"
+#include "logical_light.h"
+
+// the hue is rendered this often while the loop runs
+#ifndef COLOR_LOOP_FRAME_MS
+#define COLOR_LOOP_FRAME_MS 20
+#endif // COLOR_LOOP_FRAME_MS
+
+// EnhancedCurrentHue and the channel endpoints are brought up to date this often
+#ifndef COLOR_LOOP_PUBLISH_MS
+#define COLOR_LOOP_PUBLISH_MS 1000
+#endif // COLOR_LOOP_PUBLISH_MS
+
+// the phase is Q48 of a full hue circle, the enhanced hue is its top 16 bits
+#define PHASE_BITS 48
+#define PHASE_MASK ((1ULL << PHASE_BITS) - 1)
+#define PHASE_TO_HUE(phase) ( (uint16_t) ((phase) >> (PHASE_BITS - 16)) )
+
+// ZCL ColorMode / EnhancedColorMode of a loop
+#define COLOR_MODE_HSV               0x00
+#define ENHANCED_COLOR_MODE_ENHANCED_HUE 0x03
+// ZCL CurrentHue of 360 degrees
+#define HUE_STEPS 254
+// ZCL color control Options bit, default values of the optional OptionsMask and OptionsOverride
+#define OPTIONS_EXECUTE_IF_OFF 0x01
+#define OPTIONS_NOT_PRESENT 0xFF
+
+typedef struct {
+    bool active;
+    uint8_t endpoint;
+    bool increment;
+    uint64_t phase;
+    uint64_t rate;          // phase per sleeptimer tick
+    uint32_t ticks;         // sleeptimer tick count the phase was last advanced at
+    uint32_t published_ms;
+    sl_zigbee_event_t frame_event;
+} _color_loop_t;
+
+static _color_loop_t _loop = { .active = false };
+
+static void _start(uint16_t hue);
+static void _stop(bool restore_hue);
+static void _load_parameters(void);
+static void _publish_hue(uint16_t hue);
+static void _write_attribute(EmberAfAttributeId attributeId, uint8_t *value, EmberAfAttributeType type);
+static bool _should_execute_if_off(uint8_t options_mask, uint8_t options_override);
+static void _frame_event_handler(sl_zigbee_event_t *event);
+
+/**
+ * @brief initialize the color loop of the color light endpoint
+ */
+void color_loop_init(uint8_t endpoint)
+{
+    _loop.endpoint = endpoint;
+    sl_zigbee_event_init( &_loop.frame_event, _frame_event_handler );
+}
+
+/**
+ * @brief ColorLoopSet command
+ * @param[in] update_flags -- COLOR_LOOP_UPDATE_ bits, which of the fields below apply
+ * @param[in] action -- COLOR_LOOP_ACTION_
+ * @param[in] direction -- 0 decrements the hue, 1 increments it
+ * @param[in] time_s -- seconds for a full loop
+ * @param[in] start_hue -- enhanced hue the loop starts from with ACTIVATE_FROM_START_HUE
+ * @return ZCL status of the command
+ */
+EmberAfStatus color_loop_set(uint8_t update_flags, uint8_t action, uint8_t direction,
+                             uint16_t time_s, uint16_t start_hue)
+{
+    uint16_t hue;
+
+    if ( (update_flags & COLOR_LOOP_UPDATE_DIRECTION) && (direction > 1) ) return EMBER_ZCL_STATUS_INVALID_FIELD;
+    if ( (update_flags & COLOR_LOOP_UPDATE_ACTION) && (action > COLOR_LOOP_ACTION_ACTIVATE_FROM_HUE) ) {
+        return EMBER_ZCL_STATUS_INVALID_FIELD;
+    }
+
+    if ( update_flags & COLOR_LOOP_UPDATE_DIRECTION ) {
+        _write_attribute( ZCL_COLOR_CONTROL_COLOR_LOOP_DIRECTION_ATTRIBUTE_ID, &direction, ZCL_INT8U_ATTRIBUTE_TYPE );
+    }
+    if ( update_flags & COLOR_LOOP_UPDATE_TIME ) {
+        _write_attribute( ZCL_COLOR_CONTROL_COLOR_LOOP_TIME_ATTRIBUTE_ID, (uint8_t *) &time_s, ZCL_INT16U_ATTRIBUTE_TYPE );
+    }
+    if ( update_flags & COLOR_LOOP_UPDATE_START_HUE ) {
+        _write_attribute( ZCL_COLOR_CONTROL_COLOR_LOOP_START_ENHANCED_HUE_ATTRIBUTE_ID, (uint8_t *) &start_hue,
+                          ZCL_INT16U_ATTRIBUTE_TYPE );
+    }
+    // a running loop keeps its hue and picks up the new direction and time
+    _load_parameters();
+
+    if ( !(update_flags & COLOR_LOOP_UPDATE_ACTION) ) return EMBER_ZCL_STATUS_SUCCESS;
+
+    if ( COLOR_LOOP_ACTION_DEACTIVATE == action ) {
+        if ( _loop.active ) _stop( true );
+        return EMBER_ZCL_STATUS_SUCCESS;
+    }
+
+    if ( COLOR_LOOP_ACTION_ACTIVATE_FROM_START_HUE == action ) {
+        if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
+                _loop.endpoint, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_COLOR_LOOP_START_ENHANCED_HUE_ATTRIBUTE_ID,
+                (uint8_t *) &hue, sizeof(hue)
+        )) return EMBER_ZCL_STATUS_FAILURE;
+    } else if ( !color_loop_hue( &hue ) ) {
+        if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
+                _loop.endpoint, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_ENHANCED_CURRENT_HUE_ATTRIBUTE_ID,
+                (uint8_t *) &hue, sizeof(hue)
+        )) return EMBER_ZCL_STATUS_FAILURE;
+    }
+    _start( hue );
+    return EMBER_ZCL_STATUS_SUCCESS;
+}
+
+/**
+ * @brief handle ColorLoopSet addressed to the color light
+ * @return true if the command was consumed and answered
+ */
+bool color_loop_command_received(const EmberAfClusterCommand *cmd)
+{
+    uint16_t idx = cmd->payloadStartIndex;
+    EmberAfStatus status;
+
+    if ( (_loop.endpoint != cmd->apsFrame->destinationEndpoint) || cmd->mfgSpecific ) return false;
+    if ( (ZCL_COLOR_CONTROL_CLUSTER_ID != cmd->apsFrame->clusterId)
+         || (ZCL_COLOR_LOOP_SET_COMMAND_ID != cmd->commandId) ) return false;
+
+    if ( cmd->bufLen < idx + 7 ) {
+        status = EMBER_ZCL_STATUS_MALFORMED_COMMAND;
+    } else if ( !_should_execute_if_off(
+                    (cmd->bufLen < idx + 9) ? OPTIONS_NOT_PRESENT : emberAfGetInt8u( cmd->buffer, idx + 7, cmd->bufLen ),
+                    (cmd->bufLen < idx + 9) ? OPTIONS_NOT_PRESENT : emberAfGetInt8u( cmd->buffer, idx + 8, cmd->bufLen ) ) ) {
+        // ignored while off, same as the color control server does with the other commands
+        status = EMBER_ZCL_STATUS_SUCCESS;
+    } else {
+        status = color_loop_set( emberAfGetInt8u( cmd->buffer, idx, cmd->bufLen ),
+                                 emberAfGetInt8u( cmd->buffer, idx + 1, cmd->bufLen ),
+                                 emberAfGetInt8u( cmd->buffer, idx + 2, cmd->bufLen ),
+                                 emberAfGetInt16u( cmd->buffer, idx + 3, cmd->bufLen ),
+                                 emberAfGetInt16u( cmd->buffer, idx + 5, cmd->bufLen ) );
+    }
+    emberAfSendImmediateDefaultResponse( status );
+    return true;
+}
+
+/**
+ * @brief the color light left the hue based color mode, stops the loop where it is
+ */
+void color_loop_cancel(void)
+{
+    if ( _loop.active ) _stop( false );
+}
+
+/**
+ * @brief the color light was turned on, resumes the frames of a running loop
+ */
+void color_loop_resume(void)
+{
+    if ( !_loop.active || sl_zigbee_event_is_scheduled( &_loop.frame_event ) ) return;
+    _loop.published_ms = TIMESTAMP_MS - COLOR_LOOP_PUBLISH_MS;
+    sl_zigbee_event_set_active( &_loop.frame_event );
+}
+
+/**
+ * @brief current hue of the running loop
+ * @param[out] hue -- enhanced hue, 0x10000 == 360 degrees
+ * @return false if the loop is not running
+ */
+bool color_loop_hue(uint16_t *hue)
+{
+    if ( !_loop.active ) return false;
+    *hue = PHASE_TO_HUE( _loop.phase );
+    return true;
+}
+
+// *****************************
+// internal method implementations
+// -----------------------------
+/**
+ * @brief start the loop from the hue, or move a running loop there
+ */
+static void _start(uint16_t hue)
+{
+    uint8_t value;
+
+    if ( !_loop.active ) {
+        uint16_t stored;
+        // the hue the light goes back to when the loop is deactivated
+        if ( EMBER_ZCL_STATUS_SUCCESS == emberAfReadServerAttribute(
+                _loop.endpoint, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_ENHANCED_CURRENT_HUE_ATTRIBUTE_ID,
+                (uint8_t *) &stored, sizeof(stored)
+        )) {
+            _write_attribute( ZCL_COLOR_CONTROL_COLOR_LOOP_STORED_ENHANCED_HUE_ATTRIBUTE_ID, (uint8_t *) &stored,
+                              ZCL_INT16U_ATTRIBUTE_TYPE );
+        }
+        value = COLOR_MODE_HSV;
+        _write_attribute( ZCL_COLOR_CONTROL_COLOR_MODE_ATTRIBUTE_ID, &value, ZCL_ENUM8_ATTRIBUTE_TYPE );
+        value = ENHANCED_COLOR_MODE_ENHANCED_HUE;
+        _write_attribute( ZCL_COLOR_CONTROL_ENHANCED_COLOR_MODE_ATTRIBUTE_ID, &value, ZCL_ENUM8_ATTRIBUTE_TYPE );
+        value = 1;
+        _write_attribute( ZCL_COLOR_CONTROL_COLOR_LOOP_ACTIVE_ATTRIBUTE_ID, &value, ZCL_INT8U_ATTRIBUTE_TYPE );
+    }
+
+    _loop.phase = (uint64_t) hue << (PHASE_BITS - 16);
+    _loop.ticks = sl_sleeptimer_get_tick_count();
+    _loop.published_ms = TIMESTAMP_MS - COLOR_LOOP_PUBLISH_MS;
+    _loop.active = true;
+    sl_zigbee_event_set_active( &_loop.frame_event );
+}
+
+/**
+ * @brief stop the loop
+ * @param[in] restore_hue -- go back to the hue from before the loop started
+ */
+static void _stop(bool restore_hue)
+{
+    uint8_t value = 0;
+    uint16_t hue = PHASE_TO_HUE( _loop.phase );
+
+    _loop.active = false;
+    sl_zigbee_event_set_inactive( &_loop.frame_event );
+    _write_attribute( ZCL_COLOR_CONTROL_COLOR_LOOP_ACTIVE_ATTRIBUTE_ID, &value, ZCL_INT8U_ATTRIBUTE_TYPE );
+
+    if ( restore_hue ) {
+        (void) emberAfReadServerAttribute(
+            _loop.endpoint, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_COLOR_LOOP_STORED_ENHANCED_HUE_ATTRIBUTE_ID,
+            (uint8_t *) &hue, sizeof(hue) );
+    }
+    _publish_hue( hue );
+    if ( restore_hue ) llight_render_color( true );
+}
+
+/**
+ * @brief take the direction and the time of the loop from the attributes
+ */
+static void _load_parameters(void)
+{
+    uint8_t direction = 1;
+    uint16_t time_s = 0;
+
+    (void) emberAfReadServerAttribute(
+        _loop.endpoint, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_COLOR_LOOP_DIRECTION_ATTRIBUTE_ID,
+        &direction, sizeof(direction) );
+    (void) emberAfReadServerAttribute(
+        _loop.endpoint, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_COLOR_LOOP_TIME_ATTRIBUTE_ID,
+        (uint8_t *) &time_s, sizeof(time_s) );
+    if ( 0 == time_s ) time_s = 1;
+
+    _loop.increment = (0 != direction);
+    _loop.rate = (1ULL << PHASE_BITS) / ((uint64_t) time_s * sl_sleeptimer_get_timer_frequency());
+}
+
+/**
+ * @brief write the hue of the loop to EnhancedCurrentHue and CurrentHue
+ */
+static void _publish_hue(uint16_t hue)
+{
+    uint8_t current_hue = (uint8_t) (((uint32_t) hue * HUE_STEPS) >> 16);
+
+    _write_attribute( ZCL_COLOR_CONTROL_ENHANCED_CURRENT_HUE_ATTRIBUTE_ID, (uint8_t *) &hue, ZCL_INT16U_ATTRIBUTE_TYPE );
+    _write_attribute( ZCL_COLOR_CONTROL_CURRENT_HUE_ATTRIBUTE_ID, &current_hue, ZCL_INT8U_ATTRIBUTE_TYPE );
+}
+
+static void _write_attribute(EmberAfAttributeId attributeId, uint8_t *value, EmberAfAttributeType type)
+{
+    emberAfWriteServerAttribute( _loop.endpoint, ZCL_COLOR_CONTROL_CLUSTER_ID, attributeId, value, type );
+}
+
+/**
+ * @brief the ExecuteIfOff processing of the color control server: a command is only
+ *        executed while the light is off if the ExecuteIfOff bit of the Options attribute,
+ *        overridden by the command's OptionsOverride where its OptionsMask is set, says so
+ * @param[in] options_mask -- OptionsMask of the command, OPTIONS_NOT_PRESENT without one
+ * @param[in] options_override -- OptionsOverride of the command, OPTIONS_NOT_PRESENT without one
+ */
+static bool _should_execute_if_off(uint8_t options_mask, uint8_t options_override)
+{
+    uint8_t options = 0x00;
+    uint8_t on_off;
+
+    if ( SL_STATUS_OK != llight_get_onoff( _loop.endpoint, &on_off ) || on_off ) return true;
+    // the attribute is at its default without the optional attribute
+    (void) emberAfReadServerAttribute( _loop.endpoint, ZCL_COLOR_CONTROL_CLUSTER_ID,
+                                       ZCL_COLOR_CONTROL_OPTIONS_ATTRIBUTE_ID, &options, sizeof(options) );
+
+    if ( (OPTIONS_NOT_PRESENT == options_mask) && (OPTIONS_NOT_PRESENT == options_override) ) {
+        return options & OPTIONS_EXECUTE_IF_OFF;
+    }
+    if ( options_mask & OPTIONS_EXECUTE_IF_OFF ) return options_override & OPTIONS_EXECUTE_IF_OFF;
+    return options & OPTIONS_EXECUTE_IF_OFF;
+}
+
+/**
+ * @brief advance the phase by the sleeptimer ticks since the last frame and render the hue,
+ *        the attributes follow at the publish rate only. While the color light is off the
+ *        hue is published once and the frames stop until color_loop_resume()
+ */
+static void _frame_event_handler(sl_zigbee_event_t *event)
+{
+    uint32_t ticks = sl_sleeptimer_get_tick_count();
+    // the phase wraps at a power of two, so the product wrapping is harmless after a long pause
+    uint64_t advance = _loop.rate * (uint32_t) (ticks - _loop.ticks);
+    uint8_t on_off;
+
+    _loop.ticks = ticks;
+    _loop.phase = (_loop.increment ? _loop.phase + advance : _loop.phase - advance) & PHASE_MASK;
+
+    if ( SL_STATUS_OK != llight_get_onoff( _loop.endpoint, &on_off ) || !on_off ) {
+        _publish_hue( PHASE_TO_HUE( _loop.phase ) );
+        sl_zigbee_event_set_inactive( event );
+        return;
+    }
+
+    bool publish = (TIMESTAMP_MS - _loop.published_ms) >= COLOR_LOOP_PUBLISH_MS;
+    if ( publish ) {
+        _loop.published_ms = TIMESTAMP_MS;
+        _publish_hue( PHASE_TO_HUE( _loop.phase ) );
+    }
+    llight_render_color( publish );
+
+    sl_zigbee_event_set_delay_ms( event, COLOR_LOOP_FRAME_MS );
+}
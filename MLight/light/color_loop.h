@@ -0,0 +1,68 @@
+#ifndef _COLOR_LOOP_H_
+#define _COLOR_LOOP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "af.h"
+
+/**
+ * ColorLoop effect of the color light, run locally once started with ColorLoopSet.
+ * The hue advances from a phase accumulator on the sleeptimer tick count, the light
+ * is rendered every COLOR_LOOP_FRAME_MS while EnhancedCurrentHue and the channel
+ * endpoint levels are only written every COLOR_LOOP_PUBLISH_MS. The frames pause while
+ * the color light is off, the hue keeps advancing with time.
+ */
+
+// ColorLoopSet update flags
+#define COLOR_LOOP_UPDATE_ACTION      0x01
+#define COLOR_LOOP_UPDATE_DIRECTION   0x02
+#define COLOR_LOOP_UPDATE_TIME        0x04
+#define COLOR_LOOP_UPDATE_START_HUE   0x08
+
+// ColorLoopSet actions
+#define COLOR_LOOP_ACTION_DEACTIVATE              0x00
+#define COLOR_LOOP_ACTION_ACTIVATE_FROM_START_HUE 0x01
+#define COLOR_LOOP_ACTION_ACTIVATE_FROM_HUE       0x02
+
+/**
+ * @brief initialize the color loop of the color light endpoint
+ */
+void color_loop_init(uint8_t endpoint);
+
+/**
+ * @brief ColorLoopSet command
+ * @param[in] update_flags -- COLOR_LOOP_UPDATE_ bits, which of the fields below apply
+ * @param[in] action -- COLOR_LOOP_ACTION_
+ * @param[in] direction -- 0 decrements the hue, 1 increments it
+ * @param[in] time_s -- seconds for a full loop
+ * @param[in] start_hue -- enhanced hue the loop starts from with ACTIVATE_FROM_START_HUE
+ * @return ZCL status of the command
+ */
+EmberAfStatus color_loop_set(uint8_t update_flags, uint8_t action, uint8_t direction,
+                             uint16_t time_s, uint16_t start_hue);
+
+/**
+ * @brief handle ColorLoopSet addressed to the color light
+ * @return true if the command was consumed and answered
+ */
+bool color_loop_command_received(const EmberAfClusterCommand *cmd);
+
+/**
+ * @brief the color light left the hue based color mode, stops the loop where it is
+ */
+void color_loop_cancel(void);
+
+/**
+ * @brief the color light was turned on, resumes the frames of a running loop
+ */
+void color_loop_resume(void);
+
+/**
+ * @brief current hue of the running loop
+ * @param[out] hue -- enhanced hue, 0x10000 == 360 degrees
+ * @return false if the loop is not running
+ */
+bool color_loop_hue(uint16_t *hue);
+
+#endif // _COLOR_LOOP_H_
@@ -0,0 +1,61 @@
+#include "dimming.h"
+#include "dimming_tables.h"
+#include "hw_light_config.h"
+
+#ifndef HW_LIGHT_DIMMING_CURVE
+#define HW_LIGHT_DIMMING_CURVE DIMMING_CURVE_LINEAR
+#endif // HW_LIGHT_DIMMING_CURVE
+
+/**
+ * @brief map a ZCL level to the channel intensity through the configured curve
+ * @param[in] level -- ZCL CurrentLevel [0-255]
+ * @return channel intensity [0-65535]
+ */
+uint16_t dimming_level_to_intensity(uint8_t level)
+{
+#if HW_LIGHT_DIMMING_CURVE == DIMMING_CURVE_CIE_LIGHTNESS
+    return dimming_cie_lightness_table[level];
+#else
+    return (uint16_t) (level * 257);
+#endif
+}
+
+/**
+ * @brief inverse of dimming_level_to_intensity(), nearest level for an intensity
+ * @param[in] intensity -- channel intensity [0-65535]
+ * @return ZCL level [0-255]
+ */
+uint8_t dimming_intensity_to_level(uint16_t intensity)
+{
+#if HW_LIGHT_DIMMING_CURVE == DIMMING_CURVE_CIE_LIGHTNESS
+    // the table is monotonic, look for the first entry >= intensity
+    uint16_t lo = 0, hi = 255;
+    while ( lo < hi ) {
+        uint16_t mid = (lo + hi) >> 1;
+        if ( dimming_cie_lightness_table[mid] < intensity ) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    // and pick the closer one of the two neighbours
+    if ( lo && (intensity - dimming_cie_lightness_table[lo - 1])
+               < (dimming_cie_lightness_table[lo] - intensity) ) {
+        lo--;
+    }
+    return (uint8_t) lo;
+#else
+    return (uint8_t) (((uint32_t) intensity + 128) / 257);
+#endif
+}
+
+/**
+ * @brief dim a full level channel intensity down to the level
+ * @param[in] intensity -- channel intensity at level 255 [0-65535]
+ * @param[in] level -- ZCL CurrentLevel [0-255]
+ * @return dimmed channel intensity [0-65535]
+ */
+uint16_t dimming_apply(uint16_t intensity, uint8_t level)
+{
+    return (uint16_t) (((uint32_t) intensity * dimming_level_to_intensity( level ) + 0x7FFF) / 0xFFFF);
+}
@@ -0,0 +1,37 @@
+#ifndef _DIMMING_H_
+#define _DIMMING_H_
+
+#include <stdint.h>
+
+/**
+ * CurrentLevel -> channel intensity dimming curve. The curve is selected at compile
+ * time with HW_LIGHT_DIMMING_CURVE (hw_light_config.h) and must be applied exactly
+ * once, where the logical light renders a level into channel intensities.
+ */
+
+#define DIMMING_CURVE_LINEAR          0
+#define DIMMING_CURVE_CIE_LIGHTNESS   1
+
+/**
+ * @brief map a ZCL level to the channel intensity through the configured curve
+ * @param[in] level -- ZCL CurrentLevel [0-255]
+ * @return channel intensity [0-65535]
+ */
+uint16_t dimming_level_to_intensity(uint8_t level);
+
+/**
+ * @brief inverse of dimming_level_to_intensity(), nearest level for an intensity
+ * @param[in] intensity -- channel intensity [0-65535]
+ * @return ZCL level [0-255]
+ */
+uint8_t dimming_intensity_to_level(uint16_t intensity);
+
+/**
+ * @brief dim a full level channel intensity down to the level
+ * @param[in] intensity -- channel intensity at level 255 [0-65535]
+ * @param[in] level -- ZCL CurrentLevel [0-255]
+ * @return dimmed channel intensity [0-65535]
+ */
+uint16_t dimming_apply(uint16_t intensity, uint8_t level);
+
+#endif // _DIMMING_H_
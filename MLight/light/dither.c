@@ -0,0 +1,54 @@
+#include <stddef.h>
+#include "dither.h"
+
+/**
+ * @brief number of pattern bits which keeps the pattern repeating at least min_hz times a second
+ * @param[in] pwm_hz -- PWM frequency
+ * @param[in] min_hz -- lowest frequency the pattern may add
+ * @return pattern bits [0-DITHER_PATTERN_MAX_BITS], 0 if the PWM is too slow to dither
+ */
+uint8_t dither_pattern_bits(uint32_t pwm_hz, uint32_t min_hz)
+{
+    uint8_t bits = 0;
+
+    if ( 0 == min_hz ) return DITHER_PATTERN_MAX_BITS;
+    while ( bits < DITHER_PATTERN_MAX_BITS && (pwm_hz >> (bits + 1)) >= min_hz ) bits++;
+    return bits;
+}
+
+/**
+ * @brief build the duty pattern of an intensity
+ * @param[in] intensity -- channel intensity
+ * @param[in] intensity_max -- full scale intensity
+ * @param[in] max_duty -- PWM duty at full scale intensity
+ * @param[in] bits -- pattern bits from dither_pattern_bits()
+ * @param[out] pattern -- PWM duty of every period of the pattern, 1 << bits entries
+ * @return pattern length in PWM periods, 0 if the quantized duty is a whole duty which
+ *         needs no dithering, the pattern is not written then
+ */
+uint16_t dither_pattern_build(uint16_t intensity, uint16_t intensity_max, uint16_t max_duty,
+                              uint8_t bits, uint32_t *pattern)
+{
+    if ( NULL == pattern || 0 == intensity_max || 0 == bits || bits > DITHER_PATTERN_MAX_BITS ) return 0;
+
+    uint16_t length = (uint16_t) (1 << bits);
+    uint32_t exact = (uint32_t) intensity * max_duty;
+    uint32_t duty = exact / intensity_max;
+    // the fraction of a duty step in 1 / length units, rounded to the nearest
+    uint32_t fraction = (((exact % intensity_max) << bits) + (intensity_max >> 1)) / intensity_max;
+
+    if ( 0 == fraction || length == fraction ) return 0;
+
+    // start half way so the high periods are spread evenly across the pattern
+    uint32_t accumulator = length >> 1;
+    for ( uint16_t i = 0; i < length; i++ ) {
+        accumulator += fraction;
+        if ( accumulator >= length ) {
+            accumulator -= length;
+            pattern[i] = duty + 1;
+        } else {
+            pattern[i] = duty;
+        }
+    }
+    return length;
+}
@@ -0,0 +1,42 @@
+#ifndef _DITHER_H_
+#define _DITHER_H_
+
+#include <stdint.h>
+
+/**
+ * Temporal dithering patterns. An intensity between two PWM duties is produced by a
+ * first order sigma-delta pattern of the two duties, one duty per PWM period, which
+ * the LDMA replays into the TIMER compare buffer on every overflow. The fractional
+ * duty is quantized to 1 / (1 << bits) of a duty step, so the pattern repeats every
+ * (1 << bits) PWM periods at most and all the modulation it adds is at or above
+ * PWM frequency / (1 << bits).
+ *
+ * Plain C without any SDK dependency, tools/dither_model.py builds and checks it on the host.
+ */
+
+// longest pattern, 1 << DITHER_PATTERN_MAX_BITS PWM periods
+#define DITHER_PATTERN_MAX_BITS 5
+#define DITHER_PATTERN_MAX_LENGTH (1 << DITHER_PATTERN_MAX_BITS)
+
+/**
+ * @brief number of pattern bits which keeps the pattern repeating at least min_hz times a second
+ * @param[in] pwm_hz -- PWM frequency
+ * @param[in] min_hz -- lowest frequency the pattern may add
+ * @return pattern bits [0-DITHER_PATTERN_MAX_BITS], 0 if the PWM is too slow to dither
+ */
+uint8_t dither_pattern_bits(uint32_t pwm_hz, uint32_t min_hz);
+
+/**
+ * @brief build the duty pattern of an intensity
+ * @param[in] intensity -- channel intensity
+ * @param[in] intensity_max -- full scale intensity
+ * @param[in] max_duty -- PWM duty at full scale intensity
+ * @param[in] bits -- pattern bits from dither_pattern_bits()
+ * @param[out] pattern -- PWM duty of every period of the pattern, 1 << bits entries
+ * @return pattern length in PWM periods, 0 if the quantized duty is a whole duty which
+ *         needs no dithering, the pattern is not written then
+ */
+uint16_t dither_pattern_build(uint16_t intensity, uint16_t intensity_max, uint16_t max_duty,
+                              uint8_t bits, uint32_t *pattern);
+
+#endif // _DITHER_H_
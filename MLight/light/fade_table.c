@@ -0,0 +1,42 @@
+#include <stddef.h>
+#include "fade_table.h"
+
+/**
+ * @brief split a fade into steps evenly spaced in time. The compare value of a step is
+ *        the linear interpolation at the step end, the last step is exactly the target.
+ * @param[in] from -- compare value at the start of the fade
+ * @param[in] to -- compare value at the end of the fade
+ * @param[in] periods -- fade duration in PWM periods
+ * @param[out] steps -- step table
+ * @param[in] max_steps -- size of the step table
+ * @return number of steps used, 0 if the fade doesn't fit in max_steps
+ */
+uint8_t fade_table_build(uint32_t from, uint32_t to, uint32_t periods,
+                         fade_step_t *steps, uint8_t max_steps)
+{
+    uint32_t distance = (to > from) ? to - from : from - to;
+    uint32_t count = max_steps;
+    uint32_t min_count = (periods + FADE_TABLE_MAX_STEP_PERIODS - 1) / FADE_TABLE_MAX_STEP_PERIODS;
+
+    if ( NULL == steps || 0 == max_steps || 0 == periods ) return 0;
+    // with every step as long as it gets the fade still doesn't fit
+    if ( min_count > max_steps ) return 0;
+
+    // no more steps than compare values to go through or periods to spend, but enough
+    // to keep each step within the LDMA transfer count
+    if ( count > distance ) count = distance;
+    if ( count < min_count ) count = min_count;
+    if ( count > periods ) count = periods;
+
+    uint32_t step_end = 0;
+    for ( uint32_t i = 1; i <= count; i++ ) {
+        // integer splits of the duration and the distance, both land exactly at the end
+        uint32_t end = (uint32_t) (((uint64_t) periods * i) / count);
+        uint32_t travelled = (uint32_t) (((uint64_t) distance * i) / count);
+
+        steps[i - 1].periods = (uint16_t) (end - step_end);
+        steps[i - 1].compare = (to > from) ? from + travelled : from - travelled;
+        step_end = end;
+    }
+    return (uint8_t) count;
+}
@@ -0,0 +1,36 @@
+#ifndef _FADE_TABLE_H_
+#define _FADE_TABLE_H_
+
+#include <stdint.h>
+
+/**
+ * Step tables for the hardware (LDMA) fades. A fade from one TIMER compare value to
+ * another is split into steps, each one held for a number of PWM periods. The DMA
+ * writes the step compare value into the TIMER compare buffer once per period, so the
+ * output changes exactly on a period boundary.
+ *
+ * Plain C without any SDK dependency, tools/fade_model.py builds and checks it on the host.
+ */
+
+// longest run of a single step, the LDMA transfer count is 11 bits
+#define FADE_TABLE_MAX_STEP_PERIODS 2048
+
+typedef struct {
+    uint32_t compare;   // TIMER compare value for the step
+    uint16_t periods;   // PWM periods the step is held for [1-FADE_TABLE_MAX_STEP_PERIODS]
+} fade_step_t;
+
+/**
+ * @brief split a fade into steps evenly spaced in time. The compare value of a step is
+ *        the linear interpolation at the step end, the last step is exactly the target.
+ * @param[in] from -- compare value at the start of the fade
+ * @param[in] to -- compare value at the end of the fade
+ * @param[in] periods -- fade duration in PWM periods
+ * @param[out] steps -- step table
+ * @param[in] max_steps -- size of the step table
+ * @return number of steps used, 0 if the fade doesn't fit in max_steps
+ */
+uint8_t fade_table_build(uint32_t from, uint32_t to, uint32_t periods,
+                         fade_step_t *steps, uint8_t max_steps);
+
+#endif // _FADE_TABLE_H_
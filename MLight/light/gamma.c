@@ -0,0 +1,30 @@
+#include "gamma.h"
+#include "gamma_tables.h"
+
+/**
+ * @brief linear -> sRGB, interpolated from the encode table
+ * @param[in] linear -- linear light Q16, values >= 0x10000 saturate
+ * @return gamma encoded value [0-65535]
+ */
+uint16_t gamma_encode(uint32_t linear)
+{
+    if ( linear >= 0x10000 ) return 0xFFFF;
+
+    uint32_t pos = linear * GAMMA_ENCODE_STEPS;
+    uint32_t idx = pos >> 16;
+    uint32_t frac = pos & 0xFFFF;
+    uint32_t lo = gamma_encode_table[idx];
+    uint32_t hi = gamma_encode_table[idx + 1];
+
+    return (uint16_t) (lo + (((hi - lo) * frac + 0x8000) >> 16));
+}
+
+/**
+ * @brief sRGB -> linear, direct lookup
+ * @param[in] encoded -- 8-bit sRGB code
+ * @return linear light [0-65535], 0xFFFF == 1.0
+ */
+uint16_t gamma_decode(uint8_t encoded)
+{
+    return gamma_decode_table[encoded];
+}
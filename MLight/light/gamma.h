@@ -0,0 +1,26 @@
+#ifndef _GAMMA_H_
+#define _GAMMA_H_
+
+#include <stdint.h>
+
+/**
+ * sRGB transfer function for both color directions. Backed by the const tables
+ * in gamma_tables.h (generated by tools/gen_light_tables.py), so neither direction
+ * needs libm.
+ */
+
+/**
+ * @brief linear -> sRGB, interpolated from the encode table
+ * @param[in] linear -- linear light Q16, values >= 0x10000 saturate
+ * @return gamma encoded value [0-65535]
+ */
+uint16_t gamma_encode(uint32_t linear);
+
+/**
+ * @brief sRGB -> linear, direct lookup
+ * @param[in] encoded -- 8-bit sRGB code
+ * @return linear light [0-65535], 0xFFFF == 1.0
+ */
+uint16_t gamma_decode(uint8_t encoded);
+
+#endif // _GAMMA_H_
@@ -0,0 +1,69 @@
+// Generated by tools/gen_light_tables.py, do not edit.
+#ifndef _GAMMA_TABLES_H_
+#define _GAMMA_TABLES_H_
+
+#include <stdint.h>
+
+#define GAMMA_ENCODE_STEPS 256
+
+// linear -> sRGB, sampled at L = i / GAMMA_ENCODE_STEPS, 0xFFFF == 1.0
+static const uint16_t gamma_encode_table[257] = {
+        0,  3255,  5552,  7237,  8618,  9809, 10867, 11827, 12710, 13531,
+    14300, 15025, 15713, 16368, 16995, 17595, 18173, 18730, 19269, 19790,
+    20295, 20786, 21263, 21728, 22181, 22624, 23056, 23478, 23892, 24297,
+    24694, 25083, 25465, 25840, 26209, 26571, 26927, 27278, 27623, 27963,
+    28298, 28627, 28953, 29273, 29590, 29902, 30210, 30515, 30815, 31112,
+    31406, 31696, 31983, 32266, 32547, 32824, 33099, 33370, 33639, 33906,
+    34169, 34430, 34689, 34945, 35199, 35450, 35699, 35947, 36191, 36434,
+    36675, 36914, 37151, 37385, 37619, 37850, 38079, 38307, 38533, 38757,
+    38980, 39201, 39420, 39638, 39854, 40069, 40282, 40494, 40705, 40914,
+    41122, 41328, 41533, 41737, 41939, 42141, 42341, 42539, 42737, 42934,
+    43129, 43323, 43516, 43708, 43899, 44089, 44277, 44465, 44652, 44837,
+    45022, 45206, 45388, 45570, 45751, 45931, 46110, 46288, 46465, 46642,
+    46817, 46992, 47166, 47339, 47511, 47682, 47853, 48023, 48192, 48360,
+    48527, 48694, 48860, 49025, 49190, 49354, 49517, 49679, 49841, 50002,
+    50162, 50322, 50481, 50639, 50797, 50954, 51111, 51266, 51422, 51576,
+    51730, 51884, 52036, 52189, 52340, 52491, 52642, 52792, 52941, 53090,
+    53238, 53386, 53533, 53680, 53826, 53972, 54117, 54262, 54406, 54549,
+    54693, 54835, 54977, 55119, 55260, 55401, 55541, 55681, 55820, 55959,
+    56098, 56236, 56373, 56510, 56647, 56783, 56919, 57054, 57189, 57324,
+    57458, 57592, 57725, 57858, 57990, 58122, 58254, 58385, 58516, 58647,
+    58777, 58907, 59036, 59165, 59294, 59422, 59550, 59678, 59805, 59932,
+    60058, 60184, 60310, 60435, 60561, 60685, 60810, 60934, 61058, 61181,
+    61304, 61427, 61549, 61671, 61793, 61915, 62036, 62157, 62277, 62398,
+    62518, 62637, 62757, 62876, 62994, 63113, 63231, 63349, 63466, 63584,
+    63701, 63817, 63934, 64050, 64166, 64281, 64397, 64512, 64626, 64741,
+    64855, 64969, 65083, 65196, 65309, 65422, 65535,
+};
+
+// sRGB -> linear for each 8-bit sRGB code, 0xFFFF == 1.0
+static const uint16_t gamma_decode_table[256] = {
+        0,    20,    40,    60,    80,    99,   119,   139,   159,   179,
+      199,   219,   241,   264,   288,   313,   340,   367,   396,   427,
+      458,   491,   526,   562,   599,   637,   677,   718,   761,   805,
+      851,   898,   947,   997,  1048,  1101,  1156,  1212,  1270,  1330,
+     1391,  1453,  1517,  1583,  1651,  1720,  1790,  1863,  1937,  2013,
+     2090,  2170,  2250,  2333,  2418,  2504,  2592,  2681,  2773,  2866,
+     2961,  3058,  3157,  3258,  3360,  3464,  3570,  3678,  3788,  3900,
+     4014,  4129,  4247,  4366,  4488,  4611,  4736,  4864,  4993,  5124,
+     5257,  5392,  5530,  5669,  5810,  5953,  6099,  6246,  6395,  6547,
+     6700,  6856,  7014,  7174,  7335,  7500,  7666,  7834,  8004,  8177,
+     8352,  8528,  8708,  8889,  9072,  9258,  9445,  9635,  9828, 10022,
+    10219, 10417, 10619, 10822, 11028, 11235, 11446, 11658, 11873, 12090,
+    12309, 12530, 12754, 12980, 13209, 13440, 13673, 13909, 14146, 14387,
+    14629, 14874, 15122, 15371, 15623, 15878, 16135, 16394, 16656, 16920,
+    17187, 17456, 17727, 18001, 18277, 18556, 18837, 19121, 19407, 19696,
+    19987, 20281, 20577, 20876, 21177, 21481, 21787, 22096, 22407, 22721,
+    23038, 23357, 23678, 24002, 24329, 24658, 24990, 25325, 25662, 26001,
+    26344, 26688, 27036, 27386, 27739, 28094, 28452, 28813, 29176, 29542,
+    29911, 30282, 30656, 31033, 31412, 31794, 32179, 32567, 32957, 33350,
+    33745, 34143, 34544, 34948, 35355, 35764, 36176, 36591, 37008, 37429,
+    37852, 38278, 38706, 39138, 39572, 40009, 40449, 40891, 41337, 41785,
+    42236, 42690, 43147, 43606, 44069, 44534, 45002, 45473, 45947, 46423,
+    46903, 47385, 47871, 48359, 48850, 49344, 49841, 50341, 50844, 51349,
+    51858, 52369, 52884, 53401, 53921, 54445, 54971, 55500, 56032, 56567,
+    57105, 57646, 58190, 58737, 59287, 59840, 60396, 60955, 61517, 62082,
+    62650, 63221, 63795, 64372, 64952, 65535,
+};
+
+#endif // _GAMMA_TABLES_H_
@@ -6,29 +6,218 @@
 #include "sl_power_manager_debug.h"
 #endif // SL_POWER_MANAGER_DEBUG == 1
 #endif // SL_CATALOG_POWER_MANAGER_PRESENT
+#include "em_core.h"
+#include "em_timer.h"
 #include "hw_light.h"
+#include "hw_light_config.h"
+#include "le_pwm.h"
+#include "light_energy.h"
+#include "light_trace.h"
 #include "sl_zigbee_debug_print.h"
 #include "sl_simple_rgb_pwm_led.h"
 #include "sl_simple_rgb_pwm_led_rgb_led0_config.h"
+#if HW_LIGHT_LDMA_FADE_ENABLE || HW_LIGHT_DITHERING_ENABLE
+#include "dmadrv.h"
+#include "em_ldma.h"
+#endif // HW_LIGHT_LDMA_FADE_ENABLE || HW_LIGHT_DITHERING_ENABLE
+#if HW_LIGHT_DITHERING_ENABLE
+#include "dither.h"
+#endif // HW_LIGHT_DITHERING_ENABLE
+#if HW_LIGHT_LDMA_FADE_ENABLE
+#include "fade_table.h"
+#endif // HW_LIGHT_LDMA_FADE_ENABLE
 
 #ifndef PWM_SLEEP_THRESHOLD
 #define PWM_SLEEP_THRESHOLD (SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION - 2)
 #endif //PWM_SLEEP_THRESHOLD
-#define MAX(a, b) (a > b) ? a : b
+#ifndef PWM_FULL_ON_THRESHOLD
+#define PWM_FULL_ON_THRESHOLD (SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION - 2)
+#endif //PWM_FULL_ON_THRESHOLD
+#define PWM_MAX_DUTY (SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION - 1)
+#define RGB_CHANNEL_COUNT HW_LIGHT_COLOR_CHANNELS
 #define RGB_LIGHT (&sl_simple_rgb_pwm_led_rgb_led0)
+#define PWM_TIMER SL_SIMPLE_RGB_PWM_LED_RGB_LED0_PERIPHERAL
+// the staged duties are written to the compare buffers only while at least this much of
+// the PWM period is left, so all of them are loaded at the same overflow
+#define COMMIT_GUARD(top) ((top) >> 2)
+#if HW_LIGHT_LDMA_FADE_ENABLE || HW_LIGHT_DITHERING_ENABLE
+#if defined(_SILICON_LABS_32B_SERIES_2)
+#define TIMER_CC_BUFFER(timer, cc) (&(timer)->CC[cc].OCB)
+#define TIMER_CC_VALUE(timer, cc) ((timer)->CC[cc].OC)
+#else
+#define TIMER_CC_BUFFER(timer, cc) (&(timer)->CC[cc].CCVB)
+#define TIMER_CC_VALUE(timer, cc) ((timer)->CC[cc].CCV)
+#endif // _SILICON_LABS_32B_SERIES_2
+#endif // HW_LIGHT_LDMA_FADE_ENABLE || HW_LIGHT_DITHERING_ENABLE
+#if HW_LIGHT_DITHERING_ENABLE
+#define DITHER_MAX_DUTY (PWM_MAX_DUTY * HW_LIGHT_DITHER_MAX_DUTY_PERCENT / 100)
+#define DITHER_BITS dither_pattern_bits( SL_SIMPLE_RGB_PWM_LED_RGB_LED0_FREQUENCY, HW_LIGHT_DITHER_MIN_HZ )
+#if SL_SIMPLE_RGB_PWM_LED_RGB_LED0_FREQUENCY < 2 * HW_LIGHT_DITHER_MIN_HZ
+// not even a two period pattern repeats fast enough
+#error "The PWM frequency must be at least twice HW_LIGHT_DITHER_MIN_HZ for dithering"
+#endif // SL_SIMPLE_RGB_PWM_LED_RGB_LED0_FREQUENCY < 2 * HW_LIGHT_DITHER_MIN_HZ
+#define _dither_active(ch) (ditherState[ch].active)
+#else
+#define _dither_active(...) false
+#endif // HW_LIGHT_DITHERING_ENABLE
+#if HW_LIGHT_LDMA_FADE_ENABLE
+#define FADE_TIMER PWM_TIMER
+#define _FADE_DMA_SIGNAL(n) ldmaPeripheralSignal_TIMER##n##_UFOF
+#define FADE_DMA_SIGNAL(n) _FADE_DMA_SIGNAL(n)
+#define FADE_CC_BUFFER(cc) TIMER_CC_BUFFER(FADE_TIMER, cc)
+#define FADE_CC_VALUE(cc) TIMER_CC_VALUE(FADE_TIMER, cc)
+#if HW_LIGHT_WHITE_CHANNELS
+// a fade of one color channel moves the common part carried by the whites, which the
+// hardware fade can't follow
+#error "Hardware fades are not supported with white channels"
+#endif // HW_LIGHT_WHITE_CHANNELS
+#define _fade_active(ch) (fadeState[ch].active)
+#else
+#define _fade_active(...) false
+#endif // HW_LIGHT_LDMA_FADE_ENABLE
 
 extern sl_led_rgb_pwm_t sl_simple_rgb_pwm_led_rgb_led0;
 
+/**
+ * The color is kept twice: as the color channel intensities and as a color vector,
+ * normalized so its strongest channel is at HW_LIGHT_INTENSITY_MAX, plus the master
+ * intensity of that channel. Brightness changes scale the vector, which is only ever
+ * derived from the color at full brightness or the channel intensities written, so they
+ * never accumulate rounding.
+ */
 typedef struct {
-  uint16_t  targetLevel;
+  uint16_t  master;
+  uint16_t  vector[RGB_CHANNEL_COUNT];
+  bool      vectorFromColor;    // set from the full brightness color, not from the channels
   bool      isPowerManagementRequested;
+  uint16_t  color[RGB_CHANNEL_COUNT];
+  uint16_t  intensity[HW_LIGHT_CHANNEL_COUNT];
+  uint16_t  staged[RGB_CHANNEL_COUNT];
+  uint8_t   stagedChannels;
 } rgb_state_t;
 
 static rgb_state_t rgbState = {
-  .targetLevel = 254,
-  .isPowerManagementRequested = false
+  .master = 0,
+  .vector = { 0 },
+  .vectorFromColor = false,
+  .isPowerManagementRequested = false,
+  .color = { 0 },
+  .intensity = { 0 },
+  .staged = { 0 },
+  .stagedChannels = 0
+};
+
+#if HW_LIGHT_LDMA_FADE_ENABLE || HW_LIGHT_DITHERING_ENABLE
+// DMA channel of every light channel, a channel is either faded or dithered, never both
+static unsigned int channelDma[HW_LIGHT_CHANNEL_COUNT];
+#endif // HW_LIGHT_LDMA_FADE_ENABLE || HW_LIGHT_DITHERING_ENABLE
+
+#if HW_LIGHT_DITHERING_ENABLE
+/**
+ * Dithering of a channel. A single descriptor linked to itself writes the compare
+ * value of the next pattern period into the TIMER compare buffer on every overflow of
+ * the channel's timer, so the pattern is replayed in step with the PWM periods without
+ * waking up the CPU.
+ */
+typedef struct {
+  bool                active;
+  uint16_t            intensity;    // intensity the pattern was built for
+  uint32_t            pattern[DITHER_PATTERN_MAX_LENGTH];
+  LDMA_Descriptor_t   descriptor;
+} dither_state_t;
+
+static dither_state_t ditherState[HW_LIGHT_CHANNEL_COUNT];
+#endif // HW_LIGHT_DITHERING_ENABLE
+
+#if HW_LIGHT_LDMA_FADE_ENABLE
+/**
+ * LDMA fade of a channel. Every descriptor writes one step compare value into the
+ * TIMER compare buffer on each TIMER overflow, for as many periods as the step lasts,
+ * then links to the next step. The buffer is loaded on the next overflow, so the duty
+ * only ever changes on a PWM period boundary.
+ */
+typedef struct {
+  volatile bool       active;
+  uint16_t            average_duty;   // PWM duty averaged over the whole fade
+  fade_step_t         steps[HW_LIGHT_LDMA_FADE_STEPS];
+  LDMA_Descriptor_t   descriptors[HW_LIGHT_LDMA_FADE_STEPS];
+} fade_state_t;
+
+static fade_state_t fadeState[RGB_CHANNEL_COUNT];
+static const uint8_t fadeCcChannel[RGB_CHANNEL_COUNT] = {
+  SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RED_CHANNEL,
+  SL_SIMPLE_RGB_PWM_LED_RGB_LED0_GREEN_CHANNEL,
+  SL_SIMPLE_RGB_PWM_LED_RGB_LED0_BLUE_CHANNEL
 };
+#endif // HW_LIGHT_LDMA_FADE_ENABLE
 
+// PWM LED of every channel, indexed by enum RGB_channel_name_t
+static sl_led_pwm_t *channelPwm[HW_LIGHT_CHANNEL_COUNT];
+
+#if HW_LIGHT_WHITE_CHANNELS
+static sl_led_pwm_t whiteLed[HW_LIGHT_WHITE_CHANNELS] = {
+  {
+    .port = HW_LIGHT_WHITE_PORT,
+    .pin = HW_LIGHT_WHITE_PIN,
+    .polarity = HW_LIGHT_WHITE_POLARITY,
+    .channel = HW_LIGHT_WHITE_CHANNEL,
+    .timer = HW_LIGHT_WHITE_PERIPHERAL,
+    .frequency = SL_SIMPLE_RGB_PWM_LED_RGB_LED0_FREQUENCY,
+#if defined(HW_LIGHT_WHITE_LOC)
+    .location = HW_LIGHT_WHITE_LOC,
+#endif // HW_LIGHT_WHITE_LOC
+    .resolution = SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION,
+  },
+#if HW_LIGHT_WHITE_CHANNELS > 1
+  {
+    .port = HW_LIGHT_WARM_WHITE_PORT,
+    .pin = HW_LIGHT_WARM_WHITE_PIN,
+    .polarity = HW_LIGHT_WARM_WHITE_POLARITY,
+    .channel = HW_LIGHT_WARM_WHITE_CHANNEL,
+    .timer = HW_LIGHT_WARM_WHITE_PERIPHERAL,
+    .frequency = SL_SIMPLE_RGB_PWM_LED_RGB_LED0_FREQUENCY,
+#if defined(HW_LIGHT_WARM_WHITE_LOC)
+    .location = HW_LIGHT_WARM_WHITE_LOC,
+#endif // HW_LIGHT_WARM_WHITE_LOC
+    .resolution = SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION,
+  },
+#endif // HW_LIGHT_WHITE_CHANNELS > 1
+};
+
+// part of each color channel at full intensity a white at full intensity reproduces, per mille
+static const uint16_t whiteContent[HW_LIGHT_WHITE_CHANNELS][RGB_CHANNEL_COUNT] = {
+  { HW_LIGHT_WHITE_RED, HW_LIGHT_WHITE_GREEN, HW_LIGHT_WHITE_BLUE },
+#if HW_LIGHT_WHITE_CHANNELS > 1
+  { HW_LIGHT_WARM_WHITE_RED, HW_LIGHT_WARM_WHITE_GREEN, HW_LIGHT_WARM_WHITE_BLUE },
+#endif // HW_LIGHT_WHITE_CHANNELS > 1
+};
+
+// current a white at full intensity saves against the color channels it replaces
+#define WHITE_SAVING_MA(r, g, b, w) \
+  ( ((r) * HW_LIGHT_RED_CURRENT_MA + (g) * HW_LIGHT_GREEN_CURRENT_MA \
+     + (b) * HW_LIGHT_BLUE_CURRENT_MA) / 1000 - (w) )
+static const int32_t whiteSavingMa[HW_LIGHT_WHITE_CHANNELS] = {
+  WHITE_SAVING_MA( HW_LIGHT_WHITE_RED, HW_LIGHT_WHITE_GREEN, HW_LIGHT_WHITE_BLUE,
+                   HW_LIGHT_WHITE_CURRENT_MA ),
+#if HW_LIGHT_WHITE_CHANNELS > 1
+  WHITE_SAVING_MA( HW_LIGHT_WARM_WHITE_RED, HW_LIGHT_WARM_WHITE_GREEN, HW_LIGHT_WARM_WHITE_BLUE,
+                   HW_LIGHT_WARM_WHITE_CURRENT_MA ),
+#endif // HW_LIGHT_WHITE_CHANNELS > 1
+};
+#endif // HW_LIGHT_WHITE_CHANNELS
+
+// LED current of every channel at full intensity
+static const uint16_t channelCurrentMa[HW_LIGHT_CHANNEL_COUNT] = {
+  HW_LIGHT_RED_CURRENT_MA,
+  HW_LIGHT_GREEN_CURRENT_MA,
+  HW_LIGHT_BLUE_CURRENT_MA,
+#if HW_LIGHT_WHITE_CHANNELS
+  HW_LIGHT_WHITE_CURRENT_MA,
+#endif // HW_LIGHT_WHITE_CHANNELS
+#if HW_LIGHT_WHITE_CHANNELS > 1
+  HW_LIGHT_WARM_WHITE_CURRENT_MA,
+#endif // HW_LIGHT_WHITE_CHANNELS > 1
+};
     
 // Forward declarations for static functions    
 #if defined(SL_SIMPLE_RGB_ENABLE_PORT) && defined(SL_SIMPLE_RGB_ENABLE_PIN)
@@ -42,7 +231,44 @@ static void hw_light_disable(void);
 static bool _needs_em1();
 static void _request_em1(bool allow_em1_only);
 #endif // SL_CATALOG_POWER_MANAGER_PRESENT
-static sl_led_pwm_t* _rgb_channel_to_context( const sl_simple_rgb_pwm_led_context_t *context, enum RGB_channel_name_t ch_name );
+static void _channels_init(void);
+static sl_led_pwm_t* _channel_pwm(enum RGB_channel_name_t ch_name);
+static void _render(uint8_t channels);
+static void _normalize_color(void);
+static void _scale_vector(uint16_t master);
+#if HW_LIGHT_WHITE_CHANNELS
+static void _extract_white(uint16_t *output);
+static void _whites_follow_color(void);
+#endif // HW_LIGHT_WHITE_CHANNELS
+static uint16_t _intensity_to_pwm(uint16_t intensity);
+static void _energy_update(void);
+static bool _all_channels_in_state(sl_led_state_t state);
+static void _wait_commit_window(void);
+#if HW_LIGHT_DITHERING_ENABLE
+static void _dither_update(void);
+static void _dither_stop(enum RGB_channel_name_t ch_name);
+#else
+#define _dither_update(...)
+#define _dither_stop(...)
+#endif // HW_LIGHT_DITHERING_ENABLE
+#if HW_LIGHT_LE_PWM_ENABLE
+static void _le_pwm_update(void);
+static bool _le_pwm_duty_close(uint16_t le_duty, uint16_t pwm);
+#else
+#define le_pwm_init(...)
+#define _le_pwm_update(...)
+#endif // HW_LIGHT_LE_PWM_ENABLE
+#if HW_LIGHT_LDMA_FADE_ENABLE || HW_LIGHT_DITHERING_ENABLE
+static void _dma_init(void);
+#else
+#define _dma_init(...)
+#endif // HW_LIGHT_LDMA_FADE_ENABLE || HW_LIGHT_DITHERING_ENABLE
+#if HW_LIGHT_LDMA_FADE_ENABLE
+static void _fade_stop(enum RGB_channel_name_t ch_name);
+static bool _fade_done_cb(unsigned int channel, unsigned int sequenceNo, void *userParam);
+#else
+#define _fade_stop(...)
+#endif // HW_LIGHT_LDMA_FADE_ENABLE
 
 /**
  * @brief Initialize the RGB LED
@@ -58,10 +284,13 @@ void hw_light_init(void)
     GPIO_PinModeSet(gpioPortI, 2, gpioModePushPull, 1);
     GPIO_PinModeSet(gpioPortI, 3, gpioModePushPull, 1);
     #endif // SL_SIMPLE_RGB_ENABLE_PORT && SL_SIMPLE_RGB_ENABLE_PIN
+    _channels_init();
+    le_pwm_init();
+    _dma_init();
     hw_light_set_rgbcolor(
-        SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION-1,
-        SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION-1,
-        SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION >> 1
+        HW_LIGHT_INTENSITY_MAX,
+        HW_LIGHT_INTENSITY_MAX,
+        HW_LIGHT_INTENSITY_MAX >> 1
     );
 }
 
@@ -84,6 +313,8 @@ static void print_led_state()
  */
 void hw_light_turnon()
 {
+  // on/off is edge triggered, nothing to do for a light which is already on
+  if ( _all_channels_in_state( SL_LED_CURRENT_STATE_ON ) ) return;
   sl_zigbee_app_debug_println("Turning on RGB light");
   hw_light_enable();
   hw_light_turn_on_ch( CH_RED );
@@ -97,6 +328,7 @@ void hw_light_turnon()
  */
 void hw_light_turnoff()
 {
+  if ( _all_channels_in_state( SL_LED_CURRENT_STATE_OFF ) ) return;
   sl_zigbee_app_debug_println("Turning off RGB light");
   hw_light_turn_off_ch( CH_RED );
   hw_light_turn_off_ch( CH_GREEN );
@@ -107,61 +339,123 @@ void hw_light_turnoff()
 
 /**
  * @brief Set the RGB color of the LED
- * @param red Red color value [0-255]
- * @param green Green color value [0-255]
- * @param blue Blue color value [0-255]
+ * @param red Red intensity [0-HW_LIGHT_INTENSITY_MAX]
+ * @param green Green intensity [0-HW_LIGHT_INTENSITY_MAX]
+ * @param blue Blue intensity [0-HW_LIGHT_INTENSITY_MAX]
  */
 void hw_light_set_rgbcolor(uint16_t red, uint16_t green, uint16_t blue)
 {
-    sl_led_set_rgb_color(RGB_LIGHT, red, green, blue);
-    if ( SL_LED_CURRENT_STATE_OFF == sl_led_get_state( (const sl_led_t*) RGB_LIGHT ) ) {
-      sl_led_turn_off( (const sl_led_t*) RGB_LIGHT );
-    }
-    handle_sleep_requirements();
+    hw_light_stage_level_ch( CH_RED, red );
+    hw_light_stage_level_ch( CH_GREEN, green );
+    hw_light_stage_level_ch( CH_BLUE, blue );
+    hw_light_commit();
 }
 
 /**
- * @brief Set the brightness of the RGB LED recalculated each of the channels
- * @param brightness Brightness value [0-255]
+ * @brief Get the RGB color of the LED
+ * @param[out] red, green, blue -- channel intensities [0-HW_LIGHT_INTENSITY_MAX]
  */
-sl_status_t hw_light_set_brightness(uint8_t brightness)
+void hw_light_get_rgbcolor(uint16_t *red, uint16_t *green, uint16_t *blue)
 {
-  uint16_t red, green, blue;
-  sl_zigbee_app_debug_print("Setting brightness from %d to %d", rgbState.targetLevel, brightness);
-  sl_led_get_rgb_color(RGB_LIGHT, &red, &green, &blue);
-  red = MAX(red, 1);
-  green = MAX(green, 1);
-  blue = MAX(blue, 1);
+    *red = rgbState.color[CH_RED];
+    *green = rgbState.color[CH_GREEN];
+    *blue = rgbState.color[CH_BLUE];
+}
 
-  sl_zigbee_app_debug_print(" changing RED from %d ", red);
-  red = red * brightness / rgbState.targetLevel;
-  sl_zigbee_app_debug_print("to %d ", red);
-  sl_zigbee_app_debug_print(" changing GREEN from %d ", green);
-  green = green * brightness / rgbState.targetLevel;
-  sl_zigbee_app_debug_print("to %d ", green);
-  sl_zigbee_app_debug_print(" changing BLUE from %d ", blue);
-  blue = blue * brightness / rgbState.targetLevel;
-  sl_zigbee_app_debug_print("to %d ", blue);
+/**
+ * @brief Set the color of the RGB LED from the color at full brightness, the strongest
+ *        channel is set to the brightness and the others follow. Later brightness
+ *        changes of the same color only need hw_light_set_brightness()
+ * @param red, green, blue Channel intensities at full brightness [0-HW_LIGHT_INTENSITY_MAX]
+ * @param master Intensity of the strongest channel [0-HW_LIGHT_INTENSITY_MAX]
+ */
+void hw_light_set_color_vector(uint16_t red, uint16_t green, uint16_t blue, uint16_t master)
+{
+  const uint16_t full[RGB_CHANNEL_COUNT] = { red, green, blue };
+  uint16_t strongest = 0;
 
-  hw_light_set_rgbcolor(red, green, blue);
-  rgbState.targetLevel = MAX(brightness, 1);
+  for ( uint8_t i = 0; i < RGB_CHANNEL_COUNT; i++ ) {
+    if ( full[i] > strongest ) strongest = full[i];
+  }
+  // the same normalization as _normalize_color(), from the color before any dimming
+  for ( uint8_t i = 0; i < RGB_CHANNEL_COUNT; i++ ) {
+    rgbState.vector[i] = strongest ? (uint16_t) (((uint32_t) full[i] * HW_LIGHT_INTENSITY_MAX
+                                                  + strongest / 2) / strongest)
+                                   : HW_LIGHT_INTENSITY_MAX;
+  }
+  rgbState.vectorFromColor = true;
+  _scale_vector( master );
+}
 
+/**
+ * @brief Set the brightness of the RGB LED, the strongest channel is set to the
+ *        brightness and the others follow the color vector. One multiply per channel
+ * @param master Intensity of the strongest channel [0-HW_LIGHT_INTENSITY_MAX]
+ * @return    Status Code:
+ *            - SL_STATUS_OK   Success
+ *            - SL_STATUS_INVALID_STATE The channels were written since the last
+ *              hw_light_set_color_vector(), the color has to be set again
+ */
+sl_status_t hw_light_set_brightness(uint16_t master)
+{
+  if ( !rgbState.vectorFromColor ) return SL_STATUS_INVALID_STATE;
+  _scale_vector( master );
   return SL_STATUS_OK;
 }
 
-sl_status_t hw_light_set_level_ch(enum RGB_channel_name_t ch_name, uint16_t level)
+/**
+ * @brief Set intensity of a specific channel of the RGB led
+ * @param[in] ch_name -- channel name
+ * @param[in] intensity -- channel intensity [0-HW_LIGHT_INTENSITY_MAX]
+ * @return    Status Code:
+ *            - SL_STATUS_OK   Success
+ *            - SL_STATUS_FAIL Error
+ */
+sl_status_t hw_light_set_level_ch(enum RGB_channel_name_t ch_name, uint16_t intensity)
 {
-  sl_simple_rgb_pwm_led_context_t *context = RGB_LIGHT->led_common.context;
-  sl_led_pwm_t *ch = _rgb_channel_to_context( context, ch_name );
-  if ( NULL == ch ) return SL_STATUS_FAIL;
+  if ( SL_STATUS_OK != hw_light_stage_level_ch( ch_name, intensity ) ) return SL_STATUS_FAIL;
+  hw_light_commit();
+  return SL_STATUS_OK;
+}
 
-  if ( level == SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION - 2) level = SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION - 1;
-  sl_pwm_led_set_color( ch, level );
-  if ( SL_LED_CURRENT_STATE_OFF == ch->state ) sl_pwm_led_stop( ch );
-  handle_sleep_requirements();
+/**
+ * @brief Stage the intensity of a channel, it is written to the timer by the next
+ *        hw_light_commit() together with the other staged channels. Only the color
+ *        channels can be staged, the whites are rendered from them
+ * @param[in] ch_name -- channel name
+ * @param[in] intensity -- channel intensity [0-HW_LIGHT_INTENSITY_MAX]
+ * @return    Status Code:
+ *            - SL_STATUS_OK   Success
+ *            - SL_STATUS_FAIL Error
+ */
+sl_status_t hw_light_stage_level_ch(enum RGB_channel_name_t ch_name, uint16_t intensity)
+{
+  if ( (unsigned) ch_name >= RGB_CHANNEL_COUNT ) return SL_STATUS_FAIL;
+
+  rgbState.staged[ch_name] = intensity;
+  rgbState.stagedChannels |= 1 << ch_name;
   return SL_STATUS_OK;
 }
 
+/**
+ * @brief Write the staged channel intensities to the timer compare buffers, all of them
+ *        are loaded at the same period boundary. Sleep requirements are updated once
+ *        for the whole commit
+ */
+void hw_light_commit(void)
+{
+  uint8_t channels = rgbState.stagedChannels;
+
+  if ( !channels ) return;
+  rgbState.stagedChannels = 0;
+
+  for ( uint8_t i = 0; i < RGB_CHANNEL_COUNT; i++ ) {
+    if ( channels & (1 << i) ) rgbState.color[i] = rgbState.staged[i];
+  }
+  _normalize_color();
+  _render( channels );
+}
+
 /**
  * @brief Turn off specific channel of the RGB led
  * @param[in] ch -- channel name
@@ -197,8 +491,12 @@ sl_status_t hw_light_turn_off_ch(enum RGB_channel_name_t ch_name)
 sl_status_t hw_light_turn_ch_onoff(enum RGB_channel_name_t ch_name, bool turn_on)
 {
   sl_simple_rgb_pwm_led_context_t *context = RGB_LIGHT->led_common.context;
-  sl_led_pwm_t *ch = _rgb_channel_to_context( context, ch_name );
-  if ( NULL == ch ) return SL_STATUS_FAIL;
+  sl_led_pwm_t *ch = _channel_pwm( ch_name );
+  if ( NULL == ch || ch_name >= RGB_CHANNEL_COUNT ) return SL_STATUS_FAIL;
+  if ( ch->state == (turn_on ? SL_LED_CURRENT_STATE_ON : SL_LED_CURRENT_STATE_OFF) ) {
+    return SL_STATUS_OK;
+  }
+  LIGHT_TRACE( LIGHT_TRACE_EVT_PWM_ONOFF, ch_name, turn_on );
 
   if ( turn_on ) {
     sl_pwm_led_start( ch );
@@ -206,13 +504,177 @@ sl_status_t hw_light_turn_ch_onoff(enum RGB_channel_name_t ch_name, bool turn_on
     context->state = SL_LED_CURRENT_STATE_ON;
     hw_light_enable();
   } else {
+    _fade_stop( ch_name );
     sl_pwm_led_stop( ch );
     ch->state = SL_LED_CURRENT_STATE_OFF;
     context->state = SL_LED_CURRENT_STATE_OFF;
     hw_light_disable();
   }
+#if HW_LIGHT_WHITE_CHANNELS
+  // the whites carry the common part of the channels which are on only
+  _whites_follow_color();
+  _render( 0 );
+#endif // HW_LIGHT_WHITE_CHANNELS
+  _dither_update();
+  handle_sleep_requirements();
+  return SL_STATUS_OK;
+}
+
+/**
+ * @brief fade a channel to the intensity in hardware, the CPU isn't involved until the
+ *        fade ends. The fade starts from the current output of the channel, any other
+ *        write to the channel stops it.
+ * @param[in] ch_name -- channel name
+ * @param[in] intensity -- target intensity [0-HW_LIGHT_INTENSITY_MAX]
+ * @param[in] duration_ms -- fade duration
+ * @return    Status Code:
+ *            - SL_STATUS_OK   Fade started
+ *            - SL_STATUS_NOT_SUPPORTED Fade is too short or too long for the hardware,
+ *              the caller has to step the channel itself
+ *            - SL_STATUS_FAIL Error
+ */
+sl_status_t hw_light_fade_ch(enum RGB_channel_name_t ch_name, uint16_t intensity, uint32_t duration_ms)
+{
+#if HW_LIGHT_LDMA_FADE_ENABLE
+  sl_led_pwm_t *ch = _channel_pwm( ch_name );
+  if ( NULL == ch ) return SL_STATUS_FAIL;
+
+  // a running fade is left where it is, the new one continues from there
+  _fade_stop( ch_name );
+  // the fade takes over the DMA channel of the dithering
+  _dither_stop( ch_name );
+  if ( duration_ms < HW_LIGHT_LDMA_FADE_MIN_MS ) return SL_STATUS_NOT_SUPPORTED;
+
+  fade_state_t *fade = &fadeState[ch_name];
+  uint8_t cc = fadeCcChannel[ch_name];
+  uint32_t periods = (uint32_t) (((uint64_t) duration_ms * SL_SIMPLE_RGB_PWM_LED_RGB_LED0_FREQUENCY) / 1000);
+  // same scaling from the duty to the compare value as the PWM LED driver
+  uint32_t target = TIMER_TopGet( FADE_TIMER ) * _intensity_to_pwm( intensity )
+                    / SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION;
+  uint8_t count = fade_table_build( FADE_CC_VALUE( cc ), target, periods,
+                                    fade->steps, HW_LIGHT_LDMA_FADE_STEPS );
+  if ( !count ) return SL_STATUS_NOT_SUPPORTED;
+
+  // the energy accounting books the whole fade at its average duty
+  uint64_t compare_periods = 0;
+  uint32_t fade_periods = 0;
+  for ( uint8_t i = 0; i < count; i++ ) {
+    compare_periods += (uint64_t) fade->steps[i].compare * fade->steps[i].periods;
+    fade_periods += fade->steps[i].periods;
+  }
+  uint64_t top_periods = (uint64_t) TIMER_TopGet( FADE_TIMER ) * fade_periods;
+  uint64_t average = top_periods ? compare_periods * SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION / top_periods : 0;
+  fade->average_duty = (uint16_t) ( average > PWM_MAX_DUTY ? PWM_MAX_DUTY : average );
+
+  for ( uint8_t i = 0; i < count; i++ ) {
+    LDMA_Descriptor_t *desc = &fade->descriptors[i];
+    *desc = (LDMA_Descriptor_t) LDMA_DESCRIPTOR_LINKREL_M2P_BYTE( &fade->steps[i].compare,
+                                                                  FADE_CC_BUFFER( cc ),
+                                                                  fade->steps[i].periods,
+                                                                  1 );
+    // the same value is written on every overflow of the step
+    desc->xfer.size = ldmaCtrlSizeWord;
+    desc->xfer.srcInc = ldmaCtrlSrcIncNone;
+    desc->xfer.doneIfs = 0;
+  }
+  fade->descriptors[count - 1].xfer.link = 0;
+  fade->descriptors[count - 1].xfer.doneIfs = 1;
+
+  LDMA_TransferCfg_t cfg = LDMA_TRANSFER_CFG_PERIPHERAL( FADE_DMA_SIGNAL( SL_SIMPLE_RGB_PWM_LED_RGB_LED0_PERIPHERAL_NO ) );
+  rgbState.color[ch_name] = intensity;
+  _normalize_color();
+  rgbState.intensity[ch_name] = intensity;
+  LIGHT_TRACE( LIGHT_TRACE_EVT_PWM, ch_name, intensity );
+  fade->active = true;
+  if ( ECODE_EMDRV_DMADRV_OK != DMADRV_LdmaStartTransfer( (int) channelDma[ch_name], &cfg,
+                                                         fade->descriptors, _fade_done_cb,
+                                                         (void *) (uintptr_t) ch_name ) ) {
+    fade->active = false;
+    return SL_STATUS_FAIL;
+  }
+  _dither_update();
   handle_sleep_requirements();
   return SL_STATUS_OK;
+#else
+  (void) ch_name;
+  (void) intensity;
+  (void) duration_ms;
+  return SL_STATUS_NOT_SUPPORTED;
+#endif // HW_LIGHT_LDMA_FADE_ENABLE
+}
+
+/**
+ * @brief check if a channel is being faded in hardware
+ * @param[in] ch_name -- channel name
+ * @return true while the fade runs
+ */
+bool hw_light_fade_in_progress(enum RGB_channel_name_t ch_name)
+{
+  if ( ch_name >= RGB_CHANNEL_COUNT ) return false;
+  return _fade_active( ch_name );
+}
+
+/**
+ * @brief stop the hardware fade of a channel where it is, the channel keeps the duty
+ *        of the PWM period running at that moment
+ * @param[in] ch_name -- channel name
+ * @param[out] intensity -- channel intensity the output was stopped at, the target if
+ *             the fade was done already
+ * @return    Status Code:
+ *            - SL_STATUS_OK   Success
+ *            - SL_STATUS_FAIL Error
+ */
+sl_status_t hw_light_fade_stop_ch(enum RGB_channel_name_t ch_name, uint16_t *intensity)
+{
+  if ( ch_name >= RGB_CHANNEL_COUNT ) return SL_STATUS_FAIL;
+#if HW_LIGHT_LDMA_FADE_ENABLE
+  if ( fadeState[ch_name].active ) {
+    uint8_t cc = fadeCcChannel[ch_name];
+    uint32_t top = TIMER_TopGet( FADE_TIMER );
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    _fade_stop( ch_name );
+    // the buffer may hold the next step already, the running duty is kept instead
+    uint32_t compare = FADE_CC_VALUE( cc );
+    *FADE_CC_BUFFER( cc ) = compare;
+    CORE_EXIT_ATOMIC();
+
+    // inverse of the duty to compare value scaling of the PWM LED driver
+    uint32_t duty = top ? (compare * SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION + (top >> 1)) / top : 0;
+    if ( duty > PWM_MAX_DUTY ) duty = PWM_MAX_DUTY;
+    uint16_t stopped = (uint16_t) ((duty * HW_LIGHT_INTENSITY_MAX + (PWM_MAX_DUTY >> 1)) / PWM_MAX_DUTY);
+
+    rgbState.color[ch_name] = stopped;
+    _normalize_color();
+    rgbState.intensity[ch_name] = stopped;
+    LIGHT_TRACE( LIGHT_TRACE_EVT_PWM, ch_name, stopped );
+    _dither_update();
+    handle_sleep_requirements();
+  }
+#endif // HW_LIGHT_LDMA_FADE_ENABLE
+  *intensity = rgbState.intensity[ch_name];
+  return SL_STATUS_OK;
+}
+
+/**
+ * @brief estimate the LED current of a color, with the whites extracted the same way
+ *        the output is rendered
+ * @param[in] red, green, blue -- color channel intensities [0-HW_LIGHT_INTENSITY_MAX]
+ * @return estimated current, uA
+ */
+uint32_t hw_light_estimate_current_ua(uint16_t red, uint16_t green, uint16_t blue)
+{
+  uint16_t output[HW_LIGHT_CHANNEL_COUNT] = { red, green, blue };
+  uint32_t current_ua = 0;
+
+#if HW_LIGHT_WHITE_CHANNELS
+  _extract_white( output );
+#endif // HW_LIGHT_WHITE_CHANNELS
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+    current_ua += (uint32_t) ( (uint64_t) output[i] * channelCurrentMa[i] * 1000 / HW_LIGHT_INTENSITY_MAX );
+  }
+  return current_ua;
 }
 
 /**
@@ -220,6 +682,7 @@ sl_status_t hw_light_turn_ch_onoff(enum RGB_channel_name_t ch_name, bool turn_on
  */
 void handle_sleep_requirements()
 {
+  _le_pwm_update();
 #ifdef SL_CATALOG_POWER_MANAGER_PRESENT
 
   if ( _needs_em1() ) {
@@ -233,6 +696,7 @@ void handle_sleep_requirements()
   sl_power_manager_debug_print_em_requirements();
 #endif // NO_DEEP_SLEEP && PM_DEBUG
 #endif // SL_CATALOG_POWER_MANAGER_PRESENT
+  _energy_update();
 }
 
 /**
@@ -240,7 +704,7 @@ void handle_sleep_requirements()
  */
 uint8_t hw_light_get_brightness()
 {
-    return rgbState.targetLevel;
+    return (uint8_t) (rgbState.master / (HW_LIGHT_INTENSITY_MAX / 0xFF));
 }
 
 // *****************************************************************************
@@ -283,13 +747,27 @@ void hw_light_disable(void)
 #ifdef SL_CATALOG_POWER_MANAGER_PRESENT
 static bool _needs_em1()
 {
-  sl_simple_rgb_pwm_led_context_t *ctx = RGB_LIGHT->led_common.context;
-  uint16_t red, green, blue;
-  sl_simple_rgb_pwm_led_get_color(ctx, &red, &green, &blue);
-  
-  return ( red && (red < PWM_SLEEP_THRESHOLD) && (SL_LED_CURRENT_STATE_ON == ctx->red->state) )
-         || ( green && (green < PWM_SLEEP_THRESHOLD) && (SL_LED_CURRENT_STATE_ON == ctx->green->state) )
-         || ( blue && (blue < PWM_SLEEP_THRESHOLD) && (SL_LED_CURRENT_STATE_ON == ctx->blue->state) );
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+#if HW_LIGHT_DITHERING_ENABLE
+    // the dithered duty flips between adjacent values, a channel dithered down from
+    // duty 1 may read 0 at this very moment but still needs the TIMER and the LDMA running
+    if ( ditherState[i].active ) return true;
+#endif // HW_LIGHT_DITHERING_ENABLE
+    // LDMA and the TIMER it feeds only run in EM1
+    if ( _fade_active( i ) ) return true;
+  }
+#if HW_LIGHT_LE_PWM_ENABLE
+  // LETIMER only takes over when it drives every dimmed channel, and it runs in EM2
+  if ( le_pwm_active_channels() ) return false;
+#endif // HW_LIGHT_LE_PWM_ENABLE
+
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+    uint16_t pwm = _intensity_to_pwm( rgbState.intensity[i] );
+    if ( pwm && (pwm < PWM_SLEEP_THRESHOLD) && (SL_LED_CURRENT_STATE_ON == channelPwm[i]->state) ) {
+      return true;
+    }
+  }
+  return false;
 }
 
 static void _request_em1(bool allow_em1_only)
@@ -307,27 +785,451 @@ static void _request_em1(bool allow_em1_only)
 #endif // SL_CATALOG_POWER_MANAGER_PRESENT
 
 /**
- * @brief get PWM Led channel from RGB instance based on channel name
- * @param[in] context RWB PWM Context
+ * @brief fill the channel table, the color channels come from the RGB LED instance, the
+ *        white channels are set up here
+ */
+static void _channels_init(void)
+{
+  const sl_simple_rgb_pwm_led_context_t *context = RGB_LIGHT->led_common.context;
+
+  channelPwm[CH_RED] = context->red;
+  channelPwm[CH_GREEN] = context->green;
+  channelPwm[CH_BLUE] = context->blue;
+#if HW_LIGHT_WHITE_CHANNELS
+  for ( uint8_t i = 0; i < HW_LIGHT_WHITE_CHANNELS; i++ ) {
+    sl_pwm_led_init( &whiteLed[i] );
+    sl_pwm_led_stop( &whiteLed[i] );
+    whiteLed[i].state = SL_LED_CURRENT_STATE_OFF;
+    channelPwm[CH_WHITE + i] = &whiteLed[i];
+  }
+#endif // HW_LIGHT_WHITE_CHANNELS
+}
+
+/**
+ * @brief get PWM Led of a channel
  * @param[in] ch_name channel name
- * @return sl_led_pwm pointer
+ * @return sl_led_pwm pointer, NULL if the board doesn't have the channel
+ */
+static sl_led_pwm_t* _channel_pwm(enum RGB_channel_name_t ch_name)
+{
+  if ( (unsigned) ch_name >= HW_LIGHT_CHANNEL_COUNT ) return NULL;
+  return channelPwm[ch_name];
+}
+
+/**
+ * @brief check if all the channels of the RGB led are in the state
+ * @param[in] state -- LED state to check for
+ * @return true if every channel is in the state
+ */
+static bool _all_channels_in_state(sl_led_state_t state)
+{
+  const sl_simple_rgb_pwm_led_context_t *context = RGB_LIGHT->led_common.context;
+
+  return ( state == context->red->state )
+         && ( state == context->green->state )
+         && ( state == context->blue->state );
+}
+
+/**
+ * @brief render the color to the channel outputs and write the outputs which changed
+ *        to the timers
+ * @param[in] channels -- channel mask of the outputs to write even if unchanged
+ */
+static void _render(uint8_t channels)
+{
+  uint16_t output[HW_LIGHT_CHANNEL_COUNT];
+  uint16_t duty[HW_LIGHT_CHANNEL_COUNT];
+
+  for ( uint8_t i = 0; i < RGB_CHANNEL_COUNT; i++ ) output[i] = rgbState.color[i];
+#if HW_LIGHT_WHITE_CHANNELS
+  // a channel which is off contributes nothing to the whites
+  for ( uint8_t i = 0; i < RGB_CHANNEL_COUNT; i++ ) {
+    if ( SL_LED_CURRENT_STATE_ON != channelPwm[i]->state ) output[i] = 0;
+  }
+  _extract_white( output );
+#endif // HW_LIGHT_WHITE_CHANNELS
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+    if ( output[i] != rgbState.intensity[i] ) channels |= 1 << i;
+  }
+  if ( !channels ) return;
+
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+    if ( !(channels & (1 << i)) ) continue;
+    _fade_stop( (enum RGB_channel_name_t) i );
+    rgbState.intensity[i] = output[i];
+    duty[i] = _intensity_to_pwm( output[i] );
+    LIGHT_TRACE( LIGHT_TRACE_EVT_PWM, i, output[i] );
+  }
+  _dither_update();
+
+  // a white on a timer of its own is loaded on that timer's overflow, which is not
+  // synchronized with the RGB timer
+  CORE_DECLARE_IRQ_STATE;
+  CORE_ENTER_ATOMIC();
+  _wait_commit_window();
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+    if ( !(channels & (1 << i)) ) continue;
+    // the dithering pattern is written by the DMA from the next overflow on
+    if ( _dither_active( i ) ) continue;
+    sl_pwm_led_set_color( _channel_pwm( (enum RGB_channel_name_t) i ), duty[i] );
+  }
+  CORE_EXIT_ATOMIC();
+
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+    sl_led_pwm_t *ch = _channel_pwm( (enum RGB_channel_name_t) i );
+    if ( (channels & (1 << i)) && SL_LED_CURRENT_STATE_OFF == ch->state ) sl_pwm_led_stop( ch );
+  }
+  handle_sleep_requirements();
+}
+
+/**
+ * @brief derive the color vector and the master intensity from the color channel
+ *        intensities. Black has no color, it is kept as neutral so raising the
+ *        brightness brings up white
+ */
+static void _normalize_color(void)
+{
+  uint16_t master = 0;
+
+  for ( uint8_t i = 0; i < RGB_CHANNEL_COUNT; i++ ) {
+    if ( rgbState.color[i] > master ) master = rgbState.color[i];
+  }
+  rgbState.master = master;
+  for ( uint8_t i = 0; i < RGB_CHANNEL_COUNT; i++ ) {
+    rgbState.vector[i] = master ? (uint16_t) (((uint32_t) rgbState.color[i] * HW_LIGHT_INTENSITY_MAX
+                                                + master / 2) / master)
+                                : HW_LIGHT_INTENSITY_MAX;
+  }
+  rgbState.vectorFromColor = false;
+}
+
+/**
+ * @brief set the color channels to the color vector at the master intensity and render them
+ * @param[in] master -- intensity of the strongest color channel
+ */
+static void _scale_vector(uint16_t master)
+{
+  rgbState.master = master;
+  for ( uint8_t i = 0; i < RGB_CHANNEL_COUNT; i++ ) {
+    rgbState.color[i] = (uint16_t) (((uint32_t) rgbState.vector[i] * master
+                                     + HW_LIGHT_INTENSITY_MAX / 2) / HW_LIGHT_INTENSITY_MAX);
+  }
+  _render( (1 << RGB_CHANNEL_COUNT) - 1 );
+}
+
+#if HW_LIGHT_WHITE_CHANNELS
+/**
+ * @brief move the common part of the color channels onto the whites. The white saving
+ *        the most current goes first and takes as much as the color channels it
+ *        reproduces allow, a white which doesn't save any current stays off
+ * @param[in,out] output -- color channel intensities in, intensity of every channel out
+ */
+static void _extract_white(uint16_t *output)
+{
+  uint8_t order[HW_LIGHT_WHITE_CHANNELS];
+
+  for ( uint8_t w = 0; w < HW_LIGHT_WHITE_CHANNELS; w++ ) {
+    order[w] = w;
+    output[CH_WHITE + w] = 0;
+  }
+#if HW_LIGHT_WHITE_CHANNELS > 1
+  if ( whiteSavingMa[1] > whiteSavingMa[0] ) {
+    order[0] = 1;
+    order[1] = 0;
+  }
+#endif // HW_LIGHT_WHITE_CHANNELS > 1
+
+  for ( uint8_t i = 0; i < HW_LIGHT_WHITE_CHANNELS; i++ ) {
+    uint8_t w = order[i];
+    const uint16_t *content = whiteContent[w];
+    // a white saving current has color content, so it is bounded by the color channels
+    if ( whiteSavingMa[w] <= 0 ) continue;
+
+    uint32_t white = HW_LIGHT_INTENSITY_MAX;
+    for ( uint8_t c = 0; c < RGB_CHANNEL_COUNT; c++ ) {
+      if ( !content[c] ) continue;
+      uint32_t limit = (uint32_t) output[c] * 1000 / content[c];
+      if ( limit < white ) white = limit;
+    }
+
+    for ( uint8_t c = 0; c < RGB_CHANNEL_COUNT; c++ ) {
+      output[c] -= (uint16_t) (white * content[c] / 1000);
+    }
+    output[CH_WHITE + w] = (uint16_t) white;
+  }
+}
+
+/**
+ * @brief the whites are on while any of the color channels is
+ */
+static void _whites_follow_color(void)
+{
+  bool on = !_all_channels_in_state( SL_LED_CURRENT_STATE_OFF );
+
+  for ( uint8_t w = 0; w < HW_LIGHT_WHITE_CHANNELS; w++ ) {
+    sl_led_pwm_t *ch = &whiteLed[w];
+    if ( on && SL_LED_CURRENT_STATE_ON != ch->state ) {
+      sl_pwm_led_start( ch );
+      ch->state = SL_LED_CURRENT_STATE_ON;
+    } else if ( !on && SL_LED_CURRENT_STATE_OFF != ch->state ) {
+      sl_pwm_led_stop( ch );
+      ch->state = SL_LED_CURRENT_STATE_OFF;
+    }
+  }
+}
+#endif // HW_LIGHT_WHITE_CHANNELS
+
+/**
+ * @brief the compare buffers are loaded on the timer overflow, wait until enough of the
+ *        current PWM period is left to write all of them before it. Runs with interrupts
+ *        disabled, for at most a quarter of a period
+ */
+static void _wait_commit_window(void)
+{
+  if ( !(PWM_TIMER->STATUS & TIMER_STATUS_RUNNING) ) return;
+
+  uint32_t top = TIMER_TopGet( PWM_TIMER );
+  while ( TIMER_CounterGet( PWM_TIMER ) > top - COMMIT_GUARD( top ) ) {
+  }
+}
+
+/**
+ * @brief scale 16-bit channel intensity to the PWM duty. This is the only place where
+ *        the PWM resolution is applied.
+ * @param[in] intensity -- channel intensity [0-HW_LIGHT_INTENSITY_MAX]
+ * @return PWM duty [0-SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION-1]
+ */
+static uint16_t _intensity_to_pwm(uint16_t intensity)
+{
+  uint32_t duty = ((uint32_t) intensity * PWM_MAX_DUTY + (HW_LIGHT_INTENSITY_MAX >> 1))
+                  / HW_LIGHT_INTENSITY_MAX;
+
+  // snap almost full duty to full on, the output is steady then and doesn't keep us in EM1
+  if ( duty >= PWM_FULL_ON_THRESHOLD ) duty = PWM_MAX_DUTY;
+  return (uint16_t) duty;
+}
+
+/**
+ * @brief hand the outputs and the sleep requirement to the energy accounting. The LED
+ *        current follows the duty written to the timer, a hardware fade is booked at its
+ *        target from the start.
+ */
+static void _energy_update(void)
+{
+  uint32_t current_ua[HW_LIGHT_CHANNEL_COUNT];
+
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+    uint32_t full_ua = (uint32_t) channelCurrentMa[i] * 1000;
+
+    if ( SL_LED_CURRENT_STATE_ON != channelPwm[i]->state ) {
+      current_ua[i] = 0;
+#if HW_LIGHT_LDMA_FADE_ENABLE
+    } else if ( fadeState[i].active ) {
+      // the whole fade at its average, the owner writes the final level when it ends
+      current_ua[i] = (uint32_t) ((uint64_t) fadeState[i].average_duty * full_ua / PWM_MAX_DUTY);
+#endif // HW_LIGHT_LDMA_FADE_ENABLE
+#if HW_LIGHT_DITHERING_ENABLE
+    } else if ( ditherState[i].active ) {
+      // the dithered duty averages out to the intensity, within a fraction of a duty step
+      current_ua[i] = (uint32_t) ((uint64_t) rgbState.intensity[i] * full_ua / HW_LIGHT_INTENSITY_MAX);
+#endif // HW_LIGHT_DITHERING_ENABLE
+#if HW_LIGHT_LE_PWM_ENABLE
+    } else if ( (le_pwm_active_channels() & (1 << i)) && le_pwm_top() ) {
+      current_ua[i] = (uint32_t) ((uint64_t) le_pwm_intensity_to_duty( rgbState.intensity[i] ) * full_ua
+                                  / le_pwm_top());
+#endif // HW_LIGHT_LE_PWM_ENABLE
+    } else {
+      current_ua[i] = (uint32_t) ((uint64_t) _intensity_to_pwm( rgbState.intensity[i] ) * full_ua / PWM_MAX_DUTY);
+    }
+  }
+  light_energy_update( rgbState.isPowerManagementRequested, current_ua );
+}
+
+#if HW_LIGHT_DITHERING_ENABLE
+/**
+ * @brief DMA request signal of the overflow of a PWM timer
+ * @param[in] timer -- timer of the channel
+ */
+static LDMA_PeripheralSignal_t _dither_dma_signal(const TIMER_TypeDef *timer)
+{
+#if defined(TIMER1)
+  if ( TIMER1 == timer ) return ldmaPeripheralSignal_TIMER1_UFOF;
+#endif // TIMER1
+#if defined(TIMER2)
+  if ( TIMER2 == timer ) return ldmaPeripheralSignal_TIMER2_UFOF;
+#endif // TIMER2
+#if defined(TIMER3)
+  if ( TIMER3 == timer ) return ldmaPeripheralSignal_TIMER3_UFOF;
+#endif // TIMER3
+#if defined(TIMER4)
+  if ( TIMER4 == timer ) return ldmaPeripheralSignal_TIMER4_UFOF;
+#endif // TIMER4
+  return ldmaPeripheralSignal_TIMER0_UFOF;
+}
+
+/**
+ * @brief stop the dithering of a channel, the output stays at the last pattern duty
+ *        until the channel is written again
+ * @param[in] ch_name -- channel name
  */
-static sl_led_pwm_t* _rgb_channel_to_context( const sl_simple_rgb_pwm_led_context_t *context, enum RGB_channel_name_t ch_name )
+static void _dither_stop(enum RGB_channel_name_t ch_name)
 {
-  switch ( ch_name ) {
-    case CH_RED:
-      return context->red;
-      break;
+  if ( !ditherState[ch_name].active ) return;
+  DMADRV_StopTransfer( channelDma[ch_name] );
+  ditherState[ch_name].active = false;
+}
 
-    case CH_GREEN:
-      return context->green;
-      break;
+/**
+ * @brief recalculate which channels need dithering, start the pattern of a channel
+ *        entering dithering or changing its intensity and stop the channels leaving it.
+ *        Must be called before the rounded duty is written to the driver, so a channel
+ *        leaving dithering isn't overwritten by the DMA.
+ */
+static void _dither_update(void)
+{
+  uint8_t bits = DITHER_BITS;
 
-    case CH_BLUE:
-      return context->blue;
-      break;
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+    enum RGB_channel_name_t ch_name = (enum RGB_channel_name_t) i;
+    sl_led_pwm_t *ch = _channel_pwm( ch_name );
+    dither_state_t *state = &ditherState[i];
+    uint16_t intensity = rgbState.intensity[i];
+    bool wanted = (_intensity_to_pwm( intensity ) < DITHER_MAX_DUTY)
+                  && (SL_LED_CURRENT_STATE_ON == ch->state)
+                  && !_fade_active( i );
 
-    default:
-      return NULL;
+    if ( state->active && wanted && state->intensity == intensity ) continue;
+    _dither_stop( ch_name );
+    if ( !wanted ) continue;
+    uint16_t length = dither_pattern_build( intensity, HW_LIGHT_INTENSITY_MAX, PWM_MAX_DUTY,
+                                            bits, state->pattern );
+    if ( !length ) continue;
+
+    // same scaling from the duty to the compare value as the PWM LED driver
+    uint32_t top = TIMER_TopGet( ch->timer );
+    for ( uint16_t n = 0; n < length; n++ ) {
+      state->pattern[n] = top * state->pattern[n] / ch->resolution;
+    }
+    state->descriptor = (LDMA_Descriptor_t) LDMA_DESCRIPTOR_LINKREL_M2P_BYTE( state->pattern,
+                                                                               TIMER_CC_BUFFER( ch->timer, ch->channel ),
+                                                                               length,
+                                                                               0 );
+    // one word per overflow, the descriptor links back to itself at the end of the pattern
+    state->descriptor.xfer.size = ldmaCtrlSizeWord;
+    state->descriptor.xfer.doneIfs = 0;
+
+    LDMA_TransferCfg_t cfg = LDMA_TRANSFER_CFG_PERIPHERAL( _dither_dma_signal( ch->timer ) );
+    state->intensity = intensity;
+    if ( ECODE_EMDRV_DMADRV_OK == DMADRV_LdmaStartTransfer( (int) channelDma[i], &cfg,
+                                                           &state->descriptor, NULL, NULL ) ) {
+      state->active = true;
+    }
   }
-}
\ No newline at end of file
+}
+#endif // HW_LIGHT_DITHERING_ENABLE
+
+#if HW_LIGHT_LE_PWM_ENABLE
+/**
+ * @brief hand the dimmed channels over to LETIMER when it can drive all of them at a
+ *        single duty, give them back to the TIMER otherwise. Only a single dimmed channel
+ *        or channels dimmed together qualify, a mixed color keeps the TIMER. Every hand
+ *        over changes the PWM frequency and phase of the channels.
+ */
+static void _le_pwm_update(void)
+{
+  uint8_t dimmed = 0;
+  uint16_t duty = 0;
+  bool shared = true;
+
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+    const sl_led_pwm_t *ch = _channel_pwm( (enum RGB_channel_name_t) i );
+    uint16_t pwm = _intensity_to_pwm( rgbState.intensity[i] );
+    if ( SL_LED_CURRENT_STATE_ON != ch->state || !pwm || pwm >= PWM_SLEEP_THRESHOLD ) continue;
+
+    uint16_t le_duty = le_pwm_intensity_to_duty( rgbState.intensity[i] );
+    if ( dimmed && le_duty != duty ) shared = false;
+    // a coarse LETIMER duty would step the brightness on every EM2 entry and wake up
+    if ( !_le_pwm_duty_close( le_duty, pwm ) ) shared = false;
+    // LETIMER can't follow a fade, the channel joins once the fade is done
+    if ( _fade_active( i ) ) shared = false;
+#if HW_LIGHT_DITHERING_ENABLE
+    // the dithered duty is finer than LETIMER resolution, keep it on the TIMER
+    if ( ditherState[i].active ) shared = false;
+#endif // HW_LIGHT_DITHERING_ENABLE
+    duty = le_duty;
+    dimmed |= 1 << i;
+  }
+
+  // no point in a partial hand over, any dimmed channel left on the TIMER needs EM1
+  uint8_t channels = ( shared && duty && !(dimmed & ~le_pwm_supported_channels()) ) ? dimmed : 0;
+  uint8_t released = le_pwm_active_channels() & ~channels;
+
+  // TIMER output is stopped before LETIMER drives the pin and restarted after it let go
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+    if ( channels & (1 << i) ) {
+      sl_pwm_led_stop( _channel_pwm( (enum RGB_channel_name_t) i ) );
+    }
+  }
+  le_pwm_output( channels, duty );
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+    sl_led_pwm_t *ch = _channel_pwm( (enum RGB_channel_name_t) i );
+    if ( (released & (1 << i)) && SL_LED_CURRENT_STATE_ON == ch->state ) sl_pwm_led_start( ch );
+  }
+}
+
+/**
+ * @brief the LETIMER duty is within HW_LIGHT_LE_PWM_MAX_ERROR_PERCENT of the TIMER duty,
+ *        both compared as a share of their full scale
+ */
+static bool _le_pwm_duty_close(uint16_t le_duty, uint16_t pwm)
+{
+  uint64_t le = (uint64_t) le_duty * PWM_MAX_DUTY;
+  uint64_t timer = (uint64_t) pwm * le_pwm_top();
+  uint64_t error = ( le > timer ) ? le - timer : timer - le;
+
+  return error * 100 <= timer * HW_LIGHT_LE_PWM_MAX_ERROR_PERCENT;
+}
+#endif // HW_LIGHT_LE_PWM_ENABLE
+
+#if HW_LIGHT_LDMA_FADE_ENABLE || HW_LIGHT_DITHERING_ENABLE
+/**
+ * @brief allocate a DMA channel for each of the light channels, shared by the fades
+ *        and the dithering of the channel
+ */
+static void _dma_init(void)
+{
+  DMADRV_Init();
+  for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+    if ( ECODE_EMDRV_DMADRV_OK != DMADRV_AllocateChannel( &channelDma[i], NULL ) ) {
+      sl_zigbee_app_debug_println("Couldn't allocate a DMA channel for the light");
+    }
+  }
+}
+#endif // HW_LIGHT_LDMA_FADE_ENABLE || HW_LIGHT_DITHERING_ENABLE
+
+#if HW_LIGHT_LDMA_FADE_ENABLE
+
+/**
+ * @brief stop the LDMA fade of a channel, the output stays at the last step written
+ * @param[in] ch_name -- channel name
+ */
+static void _fade_stop(enum RGB_channel_name_t ch_name)
+{
+  if ( !fadeState[ch_name].active ) return;
+  DMADRV_StopTransfer( channelDma[ch_name] );
+  fadeState[ch_name].active = false;
+}
+
+/**
+ * @brief LDMA fade done callback, runs from the LDMA interrupt. The compare buffer holds
+ *        the target already, the sleep requirements are updated when the owner of the
+ *        fade writes the final level with hw_light_set_level_ch()
+ */
+static bool _fade_done_cb(unsigned int channel, unsigned int sequenceNo, void *userParam)
+{
+  (void) channel;
+  (void) sequenceNo;
+  fadeState[(uintptr_t) userParam].active = false;
+  return true;
+}
+#endif // HW_LIGHT_LDMA_FADE_ENABLE
@@ -1,25 +1,44 @@
-#ifndef _HW_LIGHT_H
+#ifndef _HW_LIGHT_H_
 #define _HW_LIGHT_H_
 
 #include <stdint.h>
 #include "sl_simple_rgb_pwm_led.h"
+#include "hw_light_channels_config.h"
+
+// channel intensities are carried at full 16-bit resolution, scaled to the PWM range only
+// when written to the timer
+#define HW_LIGHT_INTENSITY_MAX 0xFFFF
+
+// red, green and blue are always there, the board template adds up to two white channels.
+// The whites are driven by the render stage only, they carry the common part of the color
+#define HW_LIGHT_COLOR_CHANNELS 3
+#define HW_LIGHT_CHANNEL_COUNT (HW_LIGHT_COLOR_CHANNELS + HW_LIGHT_WHITE_CHANNELS)
 
 enum RGB_channel_name_t {
     CH_RED = 0,
     CH_GREEN,
     CH_BLUE,
-    CH_WHITE
+    CH_WHITE,
+    CH_WARM_WHITE
 };
 
 void hw_light_init(void);
 void hw_light_turnon();
 void hw_light_turnoff();
 void hw_light_set_rgbcolor(uint16_t red, uint16_t green, uint16_t blue);
-sl_status_t hw_light_set_brightness(uint8_t brightness);
+void hw_light_get_rgbcolor(uint16_t *red, uint16_t *green, uint16_t *blue);
+void hw_light_set_color_vector(uint16_t red, uint16_t green, uint16_t blue, uint16_t master);
+sl_status_t hw_light_set_brightness(uint16_t master);
 sl_status_t hw_light_turn_on_ch(enum RGB_channel_name_t ch_name);
 sl_status_t hw_light_turn_off_ch(enum RGB_channel_name_t ch_name);
 sl_status_t hw_light_turn_ch_onoff(enum RGB_channel_name_t ch_name, bool turn_on);
-sl_status_t hw_light_set_level_ch(enum RGB_channel_name_t ch_name, uint16_t color);
+sl_status_t hw_light_set_level_ch(enum RGB_channel_name_t ch_name, uint16_t intensity);
+sl_status_t hw_light_stage_level_ch(enum RGB_channel_name_t ch_name, uint16_t intensity);
+void hw_light_commit(void);
+sl_status_t hw_light_fade_ch(enum RGB_channel_name_t ch_name, uint16_t intensity, uint32_t duration_ms);
+bool hw_light_fade_in_progress(enum RGB_channel_name_t ch_name);
+sl_status_t hw_light_fade_stop_ch(enum RGB_channel_name_t ch_name, uint16_t *intensity);
+uint32_t hw_light_estimate_current_ua(uint16_t red, uint16_t green, uint16_t blue);
 
 /**
  * @brief request proper maximum sleep levels, depending if PWM is being in use
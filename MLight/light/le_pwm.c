@@ -0,0 +1,210 @@
+#include "em_cmu.h"
+#include "em_gpio.h"
+#include "em_letimer.h"
+#include "sl_simple_rgb_pwm_led.h"
+#include "sl_simple_rgb_pwm_led_rgb_led0_config.h"
+#include "sl_zigbee_debug_print.h"
+#include "hw_light.h"
+#include "le_pwm.h"
+
+#if HW_LIGHT_LE_PWM_ENABLE
+
+#define LE_PWM_OUTPUTS 2
+#define LE_PWM_CHANNEL_BIT(ch) (1 << (ch))
+
+typedef struct {
+    GPIO_Port_TypeDef port;
+    uint8_t pin;
+    bool active_low;
+} le_pwm_pin_t;
+
+// LED pins come from the RGB PWM driver configuration, LETIMER takes over the same pins
+static const le_pwm_pin_t _pins[] = {
+    [CH_RED] = { SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RED_PORT,
+                 SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RED_PIN,
+                 SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RED_POLARITY == SL_SIMPLE_RGB_PWM_LED_POLARITY_ACTIVE_LOW },
+    [CH_GREEN] = { SL_SIMPLE_RGB_PWM_LED_RGB_LED0_GREEN_PORT,
+                   SL_SIMPLE_RGB_PWM_LED_RGB_LED0_GREEN_PIN,
+                   SL_SIMPLE_RGB_PWM_LED_RGB_LED0_GREEN_POLARITY == SL_SIMPLE_RGB_PWM_LED_POLARITY_ACTIVE_LOW },
+    [CH_BLUE] = { SL_SIMPLE_RGB_PWM_LED_RGB_LED0_BLUE_PORT,
+                  SL_SIMPLE_RGB_PWM_LED_RGB_LED0_BLUE_PIN,
+                  SL_SIMPLE_RGB_PWM_LED_RGB_LED0_BLUE_POLARITY == SL_SIMPLE_RGB_PWM_LED_POLARITY_ACTIVE_LOW },
+};
+#define LE_PWM_PIN_COUNT (sizeof(_pins) / sizeof(_pins[0]))
+
+static const uint8_t _out_channel[LE_PWM_OUTPUTS] = {
+    HW_LIGHT_LE_PWM_OUT0_CHANNEL,
+    HW_LIGHT_LE_PWM_OUT1_CHANNEL
+};
+#if defined(_SILICON_LABS_32B_SERIES_1)
+static const uint8_t _out_loc[LE_PWM_OUTPUTS] = {
+    HW_LIGHT_LE_PWM_OUT0_LOC,
+    HW_LIGHT_LE_PWM_OUT1_LOC
+};
+#endif // _SILICON_LABS_32B_SERIES_1
+
+static struct {
+    uint16_t top;
+    uint8_t supported;  // channels wired to an output
+    uint8_t active;     // channels routed to LETIMER
+} _le_pwm;
+
+static void _route(uint8_t channels);
+
+/**
+ * @brief initialize LETIMER0 and check which configured channels it can drive
+ */
+void le_pwm_init(void)
+{
+    LETIMER_Init_TypeDef init = LETIMER_INIT_DEFAULT;
+
+#if defined(_SILICON_LABS_32B_SERIES_2)
+    CMU_ClockSelectSet(cmuClock_EM23GRPACLK, HW_LIGHT_LE_PWM_LFCLK);
+#else
+    CMU_ClockSelectSet(cmuClock_LFA, HW_LIGHT_LE_PWM_LFCLK);
+#endif // _SILICON_LABS_32B_SERIES_2
+    CMU_ClockEnable(cmuClock_LETIMER0, true);
+
+    for ( uint8_t out = 0; out < LE_PWM_OUTPUTS; out++ ) {
+        uint8_t ch = _out_channel[out];
+        if ( ch >= LE_PWM_PIN_COUNT ) continue;
+
+#if defined(_SILICON_LABS_32B_SERIES_2)
+        // only port A and B are powered for the low energy peripherals in EM2
+        if ( _pins[ch].port != gpioPortA && _pins[ch].port != gpioPortB ) {
+            sl_zigbee_app_debug_println("LE PWM: channel %d is not on an EM2 capable port", ch);
+            continue;
+        }
+        if ( 0 == out ) {
+            GPIO->LETIMERROUTE[0].OUT0ROUTE = (_pins[ch].port << _GPIO_LETIMER_OUT0ROUTE_PORT_SHIFT)
+                                              | (_pins[ch].pin << _GPIO_LETIMER_OUT0ROUTE_PIN_SHIFT);
+        } else {
+            GPIO->LETIMERROUTE[0].OUT1ROUTE = (_pins[ch].port << _GPIO_LETIMER_OUT1ROUTE_PORT_SHIFT)
+                                              | (_pins[ch].pin << _GPIO_LETIMER_OUT1ROUTE_PIN_SHIFT);
+        }
+#else
+        if ( 0 == out ) {
+            BUS_RegMaskedWrite(&LETIMER0->ROUTELOC0, _LETIMER_ROUTELOC0_OUT0LOC_MASK,
+                               (uint32_t) _out_loc[out] << _LETIMER_ROUTELOC0_OUT0LOC_SHIFT);
+        } else {
+            BUS_RegMaskedWrite(&LETIMER0->ROUTELOC0, _LETIMER_ROUTELOC0_OUT1LOC_MASK,
+                               (uint32_t) _out_loc[out] << _LETIMER_ROUTELOC0_OUT1LOC_SHIFT);
+        }
+#endif // _SILICON_LABS_32B_SERIES_2
+
+        // the output idles at the LED off level between the COMP1 match and the underflow
+        if ( 0 == out ) {
+            init.out0Pol = _pins[ch].active_low;
+        } else {
+            init.out1Pol = _pins[ch].active_low;
+        }
+        _le_pwm.supported |= LE_PWM_CHANNEL_BIT( ch );
+    }
+
+    init.enable = false;
+    init.comp0Top = true;
+    init.ufoa0 = letimerUFOAPwm;
+    init.ufoa1 = letimerUFOAPwm;
+    init.repMode = letimerRepeatFree;
+    LETIMER_Init(LETIMER0, &init);
+
+    _le_pwm.top = (uint16_t) (CMU_ClockFreqGet(cmuClock_LETIMER0) / HW_LIGHT_LE_PWM_FREQUENCY);
+#if defined(_SILICON_LABS_32B_SERIES_2)
+    LETIMER_TopSet(LETIMER0, _le_pwm.top);
+#else
+    LETIMER_CompareSet(LETIMER0, 0, _le_pwm.top);
+#endif // _SILICON_LABS_32B_SERIES_2
+    _route(0);
+
+    sl_zigbee_app_debug_println("LE PWM: channels 0x%02x, top %d", _le_pwm.supported, _le_pwm.top);
+}
+
+/**
+ * @brief channels wired to a LETIMER output and usable in EM2
+ * @return channel mask
+ */
+uint8_t le_pwm_supported_channels(void)
+{
+    return _le_pwm.supported;
+}
+
+/**
+ * @brief LETIMER top value, the duty of a fully on channel
+ * @return top value, 0 before le_pwm_init()
+ */
+uint16_t le_pwm_top(void)
+{
+    return _le_pwm.top;
+}
+
+/**
+ * @brief scale channel intensity to the LETIMER duty
+ * @param[in] intensity -- channel intensity [0-HW_LIGHT_INTENSITY_MAX]
+ * @return LETIMER duty, 0 if the intensity rounds down to off
+ */
+uint16_t le_pwm_intensity_to_duty(uint16_t intensity)
+{
+    return (uint16_t) (((uint32_t) intensity * _le_pwm.top + (HW_LIGHT_INTENSITY_MAX >> 1))
+                       / HW_LIGHT_INTENSITY_MAX);
+}
+
+/**
+ * @brief route the channels to LETIMER at the duty, releases the channels not in the
+ *        mask. LETIMER is stopped when no channel is left.
+ * @param[in] channels -- channel mask, must be a subset of le_pwm_supported_channels()
+ * @param[in] duty -- LETIMER duty as returned by le_pwm_intensity_to_duty()
+ */
+void le_pwm_output(uint8_t channels, uint16_t duty)
+{
+    channels &= _le_pwm.supported;
+
+    if ( channels ) {
+        LETIMER_CompareSet( LETIMER0, 1, duty );
+        if ( !_le_pwm.active ) LETIMER_Enable( LETIMER0, true );
+        _route( channels );
+    } else if ( _le_pwm.active ) {
+        // released pins fall back to the GPIO output, left at the off level by the TIMER driver
+        _route( 0 );
+        LETIMER_Enable( LETIMER0, false );
+    }
+}
+
+/**
+ * @brief channels currently driven by LETIMER
+ * @return channel mask
+ */
+uint8_t le_pwm_active_channels(void)
+{
+    return _le_pwm.active;
+}
+
+// *****************************************************************************
+// Static functions
+// ---------------------
+/**
+ * @brief enable the LETIMER outputs of the channels in the mask, disable the rest
+ * @param[in] channels -- channel mask
+ */
+static void _route(uint8_t channels)
+{
+    uint32_t routeen = 0;
+
+    for ( uint8_t out = 0; out < LE_PWM_OUTPUTS; out++ ) {
+        uint8_t ch = _out_channel[out];
+        if ( ch >= LE_PWM_PIN_COUNT || !(channels & LE_PWM_CHANNEL_BIT( ch )) ) continue;
+#if defined(_SILICON_LABS_32B_SERIES_2)
+        routeen |= GPIO_LETIMER_ROUTEEN_OUT0PEN << out;
+#else
+        routeen |= LETIMER_ROUTEPEN_OUT0PEN << out;
+#endif // _SILICON_LABS_32B_SERIES_2
+    }
+
+#if defined(_SILICON_LABS_32B_SERIES_2)
+    GPIO->LETIMERROUTE[0].ROUTEEN = routeen;
+#else
+    LETIMER0->ROUTEPEN = routeen;
+#endif // _SILICON_LABS_32B_SERIES_2
+    _le_pwm.active = channels;
+}
+
+#endif // HW_LIGHT_LE_PWM_ENABLE
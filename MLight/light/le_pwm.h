@@ -0,0 +1,68 @@
+#ifndef _LE_PWM_H_
+#define _LE_PWM_H_
+
+#include <stdint.h>
+#include "hw_light_le_pwm_config.h"
+
+/**
+ * Low-energy PWM output on LETIMER0. The TIMER used by the RGB PWM driver stops in
+ * EM2, LETIMER runs from the LF clock and keeps the outputs going while sleeping.
+ * LETIMER has one duty compare shared by both outputs, so it can only take over
+ * channels dimmed to the same duty. hw_light decides which channels to hand over and
+ * routes the TIMER away from their pins, this module only drives LETIMER.
+ *
+ * In practice that is a single dimmed channel or channels dimmed together, mixed
+ * colors keep the TIMER and EM1.
+ *
+ * Channel sets are bit masks, bit n is channel n (enum RGB_channel_name_t).
+ */
+
+// Lowest LETIMER PWM frequency, Hz. The output is modulated at full depth, IEEE 1789
+// puts the low risk flicker limit for that at 1250 Hz. The TIMER PWM of the RGB LED driver runs far above it.
+#define HW_LIGHT_LE_PWM_MIN_FREQUENCY 1250
+
+#if HW_LIGHT_LE_PWM_ENABLE && (HW_LIGHT_LE_PWM_FREQUENCY < HW_LIGHT_LE_PWM_MIN_FREQUENCY)
+#error "HW_LIGHT_LE_PWM_FREQUENCY is below the flicker safe HW_LIGHT_LE_PWM_MIN_FREQUENCY"
+#endif
+
+#if HW_LIGHT_LE_PWM_ENABLE
+/**
+ * @brief initialize LETIMER0 and check which configured channels it can drive
+ */
+void le_pwm_init(void);
+
+/**
+ * @brief channels wired to a LETIMER output and usable in EM2
+ * @return channel mask
+ */
+uint8_t le_pwm_supported_channels(void);
+
+/**
+ * @brief LETIMER top value, the duty of a fully on channel
+ * @return top value, 0 before le_pwm_init()
+ */
+uint16_t le_pwm_top(void);
+
+/**
+ * @brief scale channel intensity to the LETIMER duty
+ * @param[in] intensity -- channel intensity [0-HW_LIGHT_INTENSITY_MAX]
+ * @return LETIMER duty, 0 if the intensity rounds down to off
+ */
+uint16_t le_pwm_intensity_to_duty(uint16_t intensity);
+
+/**
+ * @brief route the channels to LETIMER at the duty, releases the channels not in the
+ *        mask. LETIMER is stopped when no channel is left.
+ * @param[in] channels -- channel mask, must be a subset of le_pwm_supported_channels()
+ * @param[in] duty -- LETIMER duty as returned by le_pwm_intensity_to_duty()
+ */
+void le_pwm_output(uint8_t channels, uint16_t duty);
+
+/**
+ * @brief channels currently driven by LETIMER
+ * @return channel mask
+ */
+uint8_t le_pwm_active_channels(void);
+#endif // HW_LIGHT_LE_PWM_ENABLE
+
+#endif // _LE_PWM_H_
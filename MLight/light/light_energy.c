@@ -0,0 +1,188 @@
+#include "af.h"
+#ifdef SL_COMPONENT_CATALOG_PRESENT
+#include "sl_component_catalog.h"
+#endif // SL_COMPONENT_CATALOG_PRESENT
+#include "sl_sleeptimer.h"
+#include "sl_zigbee_debug_print.h"
+#ifdef SL_CATALOG_CLI_PRESENT
+#include "sl_cli.h"
+#endif // SL_CATALOG_CLI_PRESENT
+
+#include "light_energy.h"
+
+// the Power Configuration attributes are brought up to date this often
+#ifndef LIGHT_ENERGY_PUBLISH_S
+#define LIGHT_ENERGY_PUBLISH_S 60
+#endif // LIGHT_ENERGY_PUBLISH_S
+
+#define TICKS_TO_S(ticks) ( (uint32_t) ((ticks) / sl_sleeptimer_get_timer_frequency()) )
+#define CHARGE_TO_UAH(charge) ( (uint32_t) ((charge) / ((uint64_t) sl_sleeptimer_get_timer_frequency() * 3600)) )
+
+/**
+ * The state between two updates is constant, so the totals are integrated exactly as
+ * the time since the previous update at the previous state. The charge is kept in
+ * uA * sleeptimer ticks, which lasts for years at any current the board can draw.
+ */
+typedef struct {
+    uint64_t ticks;         // sleeptimer tick count the totals are integrated up to
+    bool em1;
+    uint32_t current_ua[HW_LIGHT_CHANNEL_COUNT];
+    uint64_t elapsed_ticks;
+    uint64_t em1_ticks;
+    uint64_t charge[HW_LIGHT_CHANNEL_COUNT];
+    uint8_t endpoint;
+    sl_zigbee_event_t publish_event;
+} _light_energy_t;
+
+static _light_energy_t _energy = { .endpoint = 0 };
+
+static void _integrate(void);
+static void _update_attributes(void);
+static void _publish_event_handler(sl_zigbee_event_t *event);
+
+/**
+ * @brief start publishing the totals in the Power Configuration attributes of the endpoint
+ */
+void light_energy_init(uint8_t endpoint)
+{
+    _energy.endpoint = endpoint;
+    sl_zigbee_event_init( &_energy.publish_event, _publish_event_handler );
+    sl_zigbee_event_set_active( &_energy.publish_event );
+}
+
+/**
+ * @brief the light outputs or the sleep requirement changed, books the time since the
+ *        last update at the previous state
+ * @param[in] em1 -- the light holds the EM1 requirement
+ * @param[in] current_ua -- estimated LED current of every channel, uA
+ */
+void light_energy_update(bool em1, const uint32_t current_ua[HW_LIGHT_CHANNEL_COUNT])
+{
+    _integrate();
+    _energy.em1 = em1;
+    for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) _energy.current_ua[i] = current_ua[i];
+}
+
+/**
+ * @brief get the totals, up to now
+ */
+void light_energy_get(light_energy_t *energy)
+{
+    _integrate();
+    energy->elapsed_s = TICKS_TO_S( _energy.elapsed_ticks );
+    energy->em1_s = TICKS_TO_S( _energy.em1_ticks );
+
+    uint64_t total = 0;
+    for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+        energy->led_charge_uah[i] = CHARGE_TO_UAH( _energy.charge[i] );
+        total += _energy.charge[i];
+    }
+    energy->led_charge_total_uah = CHARGE_TO_UAH( total );
+}
+
+/**
+ * @brief clear the totals
+ */
+void light_energy_reset(void)
+{
+    _integrate();
+    _energy.elapsed_ticks = 0;
+    _energy.em1_ticks = 0;
+    MEMSET( _energy.charge, 0, sizeof(_energy.charge) );
+    _update_attributes();
+}
+
+// *****************************
+// internal method implementations
+// -----------------------------
+static void _integrate(void)
+{
+    uint64_t ticks = sl_sleeptimer_get_tick_count64();
+    uint64_t delta = ticks - _energy.ticks;
+
+    _energy.ticks = ticks;
+    _energy.elapsed_ticks += delta;
+    if ( _energy.em1 ) _energy.em1_ticks += delta;
+    for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+        _energy.charge[i] += delta * _energy.current_ua[i];
+    }
+}
+
+/**
+ * @brief publish the totals in the manufacturer specific Power Configuration attributes,
+ *        an endpoint without the attributes just fails the writes
+ */
+static void _update_attributes(void)
+{
+    light_energy_t energy;
+
+    if ( !_energy.endpoint ) return;
+    light_energy_get( &energy );
+
+    emberAfWriteManufacturerSpecificServerAttribute(
+        _energy.endpoint, ZCL_POWER_CONFIG_CLUSTER_ID, LIGHT_ENERGY_ELAPSED_ATTRIBUTE_ID,
+        LIGHT_ENERGY_MFG_CODE, (uint8_t *) &energy.elapsed_s, ZCL_INT32U_ATTRIBUTE_TYPE );
+    emberAfWriteManufacturerSpecificServerAttribute(
+        _energy.endpoint, ZCL_POWER_CONFIG_CLUSTER_ID, LIGHT_ENERGY_EM1_TIME_ATTRIBUTE_ID,
+        LIGHT_ENERGY_MFG_CODE, (uint8_t *) &energy.em1_s, ZCL_INT32U_ATTRIBUTE_TYPE );
+    emberAfWriteManufacturerSpecificServerAttribute(
+        _energy.endpoint, ZCL_POWER_CONFIG_CLUSTER_ID, LIGHT_ENERGY_LED_CHARGE_ATTRIBUTE_ID,
+        LIGHT_ENERGY_MFG_CODE, (uint8_t *) &energy.led_charge_total_uah, ZCL_INT32U_ATTRIBUTE_TYPE );
+}
+
+static void _publish_event_handler(sl_zigbee_event_t *event)
+{
+    _update_attributes();
+    sl_zigbee_event_set_delay_ms( event, LIGHT_ENERGY_PUBLISH_S * 1000UL );
+}
+
+// -----------------------------------------------------------------------------
+// CLI related functions
+
+#ifdef SL_CATALOG_CLI_PRESENT
+static const char *_channel_names[HW_LIGHT_CHANNEL_COUNT] = {
+    "red", "green", "blue",
+#if HW_LIGHT_WHITE_CHANNELS
+    "white",
+#endif // HW_LIGHT_WHITE_CHANNELS
+#if HW_LIGHT_WHITE_CHANNELS > 1
+    "warm white",
+#endif // HW_LIGHT_WHITE_CHANNELS > 1
+};
+
+/***************************************************************************//**
+ * Command Line Interface callback, prints the energy totals of the light
+ *
+ * @param[in] arguments command line argument list
+ ******************************************************************************/
+void light_energy_print_from_cli(sl_cli_command_arg_t *arguments)
+{
+    (void) arguments;
+    light_energy_t energy;
+
+    light_energy_get( &energy );
+    sl_zigbee_app_debug_println("Light energy over %lu s", (unsigned long) energy.elapsed_s);
+    sl_zigbee_app_debug_println("  EM1 held: %lu s", (unsigned long) energy.em1_s);
+    sl_zigbee_app_debug_print("  LED charge uAh:");
+    for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+        sl_zigbee_app_debug_print(" %s %lu", _channel_names[i], (unsigned long) energy.led_charge_uah[i]);
+    }
+    sl_zigbee_app_debug_println(" total %lu", (unsigned long) energy.led_charge_total_uah);
+    sl_zigbee_app_debug_print("  LED current uA now:");
+    for ( uint8_t i = 0; i < HW_LIGHT_CHANNEL_COUNT; i++ ) {
+        sl_zigbee_app_debug_print(" %s %lu", _channel_names[i], (unsigned long) _energy.current_ua[i]);
+    }
+    sl_zigbee_app_debug_println("");
+}
+
+/***************************************************************************//**
+ * Command Line Interface callback, clears the energy totals of the light
+ *
+ * @param[in] arguments command line argument list
+ ******************************************************************************/
+void light_energy_reset_from_cli(sl_cli_command_arg_t *arguments)
+{
+    (void) arguments;
+    light_energy_reset();
+}
+#endif // SL_CATALOG_CLI_PRESENT
@@ -0,0 +1,53 @@
+#ifndef _LIGHT_ENERGY_H_
+#define _LIGHT_ENERGY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hw_light.h"
+
+/**
+ * Energy accounting of the light, fed by hw_light whenever its outputs or its sleep
+ * requirement change. Integrates the time the EM1 requirement is held and the LED
+ * current estimated from the duty of every channel and the channel currents of the
+ * board. Readable with the "light_energy" CLI command and as manufacturer specific
+ * attributes of the Power Configuration cluster.
+ */
+
+// Manufacturer specific Power Configuration attributes, see config/zcl/mlight-manufacturer.xml
+#define LIGHT_ENERGY_MFG_CODE                   0x1002
+#define LIGHT_ENERGY_ELAPSED_ATTRIBUTE_ID       0xF000
+#define LIGHT_ENERGY_EM1_TIME_ATTRIBUTE_ID      0xF001
+#define LIGHT_ENERGY_LED_CHARGE_ATTRIBUTE_ID    0xF002
+
+typedef struct {
+    uint32_t elapsed_s;     // since the last reset
+    uint32_t em1_s;         // with the EM1 requirement of the light held
+    uint32_t led_charge_uah[HW_LIGHT_CHANNEL_COUNT];
+    uint32_t led_charge_total_uah;
+} light_energy_t;
+
+/**
+ * @brief start publishing the totals in the Power Configuration attributes of the endpoint
+ */
+void light_energy_init(uint8_t endpoint);
+
+/**
+ * @brief the light outputs or the sleep requirement changed, books the time since the
+ *        last update at the previous state
+ * @param[in] em1 -- the light holds the EM1 requirement
+ * @param[in] current_ua -- estimated LED current of every channel, uA
+ */
+void light_energy_update(bool em1, const uint32_t current_ua[HW_LIGHT_CHANNEL_COUNT]);
+
+/**
+ * @brief get the totals, up to now
+ */
+void light_energy_get(light_energy_t *energy);
+
+/**
+ * @brief clear the totals
+ */
+void light_energy_reset(void);
+
+#endif // _LIGHT_ENERGY_H_
@@ -0,0 +1,108 @@
+#include "af.h"
+#ifdef SL_COMPONENT_CATALOG_PRESENT
+#include "sl_component_catalog.h"
+#endif // SL_COMPONENT_CATALOG_PRESENT
+#include "em_core.h"
+#include "sl_sleeptimer.h"
+#include "sl_zigbee_debug_print.h"
+#ifdef SL_CATALOG_CLI_PRESENT
+#include "sl_cli.h"
+#endif // SL_CATALOG_CLI_PRESENT
+
+#include "light_trace.h"
+
+#if HW_LIGHT_TRACE_ENABLE
+
+typedef struct {
+    light_trace_record_t records[HW_LIGHT_TRACE_RECORDS];
+    uint16_t head;      // next record to write
+    uint16_t count;     // records in the ring
+    uint32_t dropped;   // records overwritten or refused since the last drain
+    bool draining;      // the ring is being printed, new records are refused
+} light_trace_ring_t;
+
+static light_trace_ring_t _ring;
+
+/**
+ * @brief append a record to the trace ring, overwrites the oldest one when full
+ */
+void light_trace(light_trace_event_t event, uint8_t endpoint, uint16_t value)
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    if ( _ring.draining ) {
+        _ring.dropped++;
+        CORE_EXIT_ATOMIC();
+        return;
+    }
+    light_trace_record_t *record = &_ring.records[_ring.head];
+    record->ticks = sl_sleeptimer_get_tick_count();
+    record->event = (uint8_t) event;
+    record->endpoint = endpoint;
+    record->value = value;
+
+    _ring.head = (_ring.head + 1) % HW_LIGHT_TRACE_RECORDS;
+    if ( _ring.count < HW_LIGHT_TRACE_RECORDS ) {
+        _ring.count++;
+    } else {
+        _ring.dropped++;
+    }
+    CORE_EXIT_ATOMIC();
+}
+
+// -----------------------------------------------------------------------------
+// CLI related functions
+
+#ifdef SL_CATALOG_CLI_PRESENT
+/***************************************************************************//**
+ * Command Line Interface callback, prints and empties the trace ring. One record per
+ * line: "LT <ticks> <event> <endpoint> <value>", preceded by the tick frequency and
+ * the number of dropped records. Recording stops while the ring is printed, so the
+ * records stay in order, the ones refused meanwhile count as dropped in the next drain.
+ *
+ * @param[in] arguments command line argument list
+ ******************************************************************************/
+void light_trace_drain_from_cli(sl_cli_command_arg_t *arguments)
+{
+    (void) arguments;
+    light_trace_record_t record;
+    uint16_t count, tail;
+    uint32_t dropped;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_ATOMIC();
+    count = _ring.count;
+    dropped = _ring.dropped;
+    tail = (_ring.head + HW_LIGHT_TRACE_RECORDS - count) % HW_LIGHT_TRACE_RECORDS;
+    _ring.dropped = 0;
+    _ring.draining = true;
+    CORE_EXIT_ATOMIC();
+
+    sl_zigbee_app_debug_println("LT freq %lu dropped %lu",
+        (unsigned long) sl_sleeptimer_get_timer_frequency(), (unsigned long) dropped);
+    for ( uint16_t i = 0; i < count; i++ ) {
+        record = _ring.records[tail];
+        tail = (tail + 1) % HW_LIGHT_TRACE_RECORDS;
+        sl_zigbee_app_debug_println("LT %lu %u %u %u",
+            (unsigned long) record.ticks, record.event, record.endpoint, record.value);
+    }
+
+    CORE_ENTER_ATOMIC();
+    _ring.count = 0;
+    _ring.draining = false;
+    CORE_EXIT_ATOMIC();
+    sl_zigbee_app_debug_println("LT end");
+}
+#endif // SL_CATALOG_CLI_PRESENT
+
+#else // !HW_LIGHT_TRACE_ENABLE
+
+#ifdef SL_CATALOG_CLI_PRESENT
+void light_trace_drain_from_cli(sl_cli_command_arg_t *arguments)
+{
+    (void) arguments;
+    sl_zigbee_app_debug_println("Light trace is disabled, see HW_LIGHT_TRACE_ENABLE");
+}
+#endif // SL_CATALOG_CLI_PRESENT
+
+#endif // HW_LIGHT_TRACE_ENABLE
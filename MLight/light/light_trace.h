@@ -0,0 +1,44 @@
+#ifndef _LIGHT_TRACE_H_
+#define _LIGHT_TRACE_H_
+
+#include <stdint.h>
+#include "hw_light_config.h"
+
+/**
+ * Binary trace of the light pipeline. Each event is a fixed 8 byte record in a RAM
+ * ring, so tracing doesn't distort the timing it measures the way printing does.
+ * The ring is drained with the "light_trace" CLI command and the output decoded by
+ * tools/light_trace_decode.py. Keep the event ids in sync with the decoder.
+ */
+
+typedef enum {
+    LIGHT_TRACE_EVT_COMMAND     = 1,    // ZCL command received, value: cluster id
+    LIGHT_TRACE_EVT_ONOFF       = 2,    // OnOff attribute changed, value: on/off
+    LIGHT_TRACE_EVT_LEVEL       = 3,    // CurrentLevel attribute changed, value: level
+    LIGHT_TRACE_EVT_COLOR_X     = 4,    // CurrentX attribute changed, value: x
+    LIGHT_TRACE_EVT_COLOR_Y     = 5,    // CurrentY attribute changed, value: y
+    LIGHT_TRACE_EVT_RENDER      = 6,    // color light rendered to the channels
+    LIGHT_TRACE_EVT_RECONCILE   = 7,    // color light derived from the channels
+    LIGHT_TRACE_EVT_PWM         = 8,    // channel intensity applied, endpoint: channel, value: intensity
+    LIGHT_TRACE_EVT_PWM_ONOFF   = 9,    // channel turned on/off, endpoint: channel, value: on/off
+    LIGHT_TRACE_EVT_FRAME       = 10,   // level-control transition frame, value: interpolated level
+} light_trace_event_t;
+
+typedef struct {
+    uint32_t ticks;     // sleeptimer ticks
+    uint8_t event;      // light_trace_event_t
+    uint8_t endpoint;
+    uint16_t value;
+} light_trace_record_t;
+
+#if HW_LIGHT_TRACE_ENABLE
+/**
+ * @brief append a record to the trace ring, overwrites the oldest one when full
+ */
+void light_trace(light_trace_event_t event, uint8_t endpoint, uint16_t value);
+#define LIGHT_TRACE(event, endpoint, value) light_trace( (event), (endpoint), (uint16_t) (value) )
+#else
+#define LIGHT_TRACE(event, endpoint, value)
+#endif // HW_LIGHT_TRACE_ENABLE
+
+#endif // _LIGHT_TRACE_H_
@@ -1,4 +1,3 @@
-#include <math.h>
 #include PLATFORM_HEADER
 #include "hal.h"
 #include "ember.h"
@@ -6,9 +5,18 @@
 #ifdef SL_CATALOG_ZIGBEE_DEBUG_PRINT_PRESENT
 #include "sl_zigbee_debug_print.h"
 #endif // SL_CATALOG_ZIGBEE_DEBUG_PRINT_PRESENT
+#ifdef SL_CATALOG_ZIGBEE_SCENES_PRESENT
+#include "app/framework/plugin/scenes/scenes.h"
+#endif // SL_CATALOG_ZIGBEE_SCENES_PRESENT
 
 #include "app.h"
+#include "color_conv.h"
+#include "color_loop.h"
+#include "dimming.h"
 #include "hw_light.h"
+#include "hw_light_config.h"
+#include "light_energy.h"
+#include "light_trace.h"
 #include "logical_light.h"
 
 #define EP_RGB_LIGHT     1
@@ -16,6 +24,58 @@
 #define EP_GREEN_CHANNEL 3
 #define EP_BLUE_CHANNEL  4
 
+// Level and Color Control transitions tick independently, changes of the color light
+// within one frame are merged into a single render
+#ifndef LLIGHT_RENDER_FRAME_MS
+#define LLIGHT_RENDER_FRAME_MS 20
+#endif // LLIGHT_RENDER_FRAME_MS
+
+// While the channels are transitioning, the color light xy is re-derived at most this often
+#ifndef LLIGHT_COLOR_SYNC_INTERVAL_MS
+#define LLIGHT_COLOR_SYNC_INTERVAL_MS 250
+#endif // LLIGHT_COLOR_SYNC_INTERVAL_MS
+
+// Keyframes rendered for a color light transition with a known end, render frames in
+// between are interpolated from the two nearest ones
+#ifndef LLIGHT_KEYFRAMES
+#define LLIGHT_KEYFRAMES 16
+#endif // LLIGHT_KEYFRAMES
+
+// Largest valid CurrentX / CurrentY
+#define LLIGHT_MAX_CIE_XY 0xFEFF
+
+// ZCL ColorMode, the attributes the color light is rendered from
+#define LLIGHT_COLOR_MODE_HSV          0x00
+#define LLIGHT_COLOR_MODE_XY           0x01
+#define LLIGHT_COLOR_MODE_TEMPERATURE  0x02
+// ZCL EnhancedColorMode, HSV with the hue in EnhancedCurrentHue instead of CurrentHue
+#define LLIGHT_ENHANCED_COLOR_MODE_ENHANCED_HUE 0x03
+// ZCL CurrentHue of 360 degrees
+#define LLIGHT_HUE_STEPS 254
+
+// What has to be reconciled between the color light and the channel endpoints, only
+// one direction is pending at a time, the most recent change wins
+#define LLIGHT_DIRTY_COLOR     0x01    // color light changed, render it to the channels
+#define LLIGHT_DIRTY_CHANNELS  0x02    // a channel changed, derive the color light from them
+#define LLIGHT_EP_BIT(endpoint) \
+    ( ((endpoint) >= EP_RGB_LIGHT && (endpoint) <= EP_BLUE_CHANNEL) ? 1 << ((endpoint) - EP_RGB_LIGHT) : 0 )
+
+// ZCL levels are 8-bit, the hardware takes 16-bit intensities through the dimming curve
+#define LEVEL_TO_INTENSITY(level) dimming_level_to_intensity( level )
+#define INTENSITY_TO_LEVEL(intensity) dimming_intensity_to_level( intensity )
+
+// channel endpoints and the color channels they drive, the white channels of the
+// fixture have no endpoint of their own, hw_light renders them from the color
+static const struct {
+    uint8_t endpoint;
+    enum RGB_channel_name_t ch_name;
+} _channel_endpoints[] = {
+    { EP_RED_CHANNEL, CH_RED },
+    { EP_GREEN_CHANNEL, CH_GREEN },
+    { EP_BLUE_CHANNEL, CH_BLUE },
+};
+#define CHANNEL_ENDPOINT_COUNT (sizeof(_channel_endpoints) / sizeof(_channel_endpoints[0]))
+
 typedef struct {
     uint8_t endpoint;
     uint8_t *onoff;
@@ -28,9 +88,73 @@ typedef struct {
     uint8_t level;
 } cluster_init_counter_t;
 
+// RAM copy of the light endpoints state, kept coherent through the post attribute
+// change callback, so the per tick paths don't walk the attribute table
+typedef struct {
+    uint8_t on_off;
+    uint8_t level;
+} _ep_shadow_t;
+
+// hue and saturation attributes of the color light, which hue is rendered depends on
+// EnhancedColorMode
+typedef struct {
+    uint8_t current_hue;
+    uint16_t enhanced_hue;
+    uint8_t saturation;
+    uint8_t enhanced_color_mode;
+} _hsv_attributes_t;
+
+typedef struct {
+    bool valid;
+    _ep_shadow_t ep[EP_BLUE_CHANNEL - EP_RGB_LIGHT + 1];
+    uint16_t color_x;
+    uint16_t color_y;
+    uint8_t color_mode;
+    uint16_t color_temp_mireds;
+    _hsv_attributes_t hsv;
+} _shadow_state_t;
+
+// linear move of one color light attribute, as run by the level or color control server
+typedef struct {
+    uint16_t from;
+    uint16_t to;
+    uint32_t start_ms;
+    uint32_t duration_ms;
+} _motion_t;
+
+// channel intensities of the color light transition, rendered once when it starts
+typedef struct {
+    bool valid;
+    uint8_t color_mode; // LLIGHT_COLOR_MODE_TEMPERATURE follows the mireds motion instead of x / y
+    _motion_t color_x;
+    _motion_t color_y;
+    _motion_t mireds;
+    _motion_t level;
+    uint32_t start_ms;
+    uint32_t span_ms;
+    uint16_t frames[LLIGHT_KEYFRAMES][3];
+} _keyframes_t;
+
+// color of the last color light render done as a color vector in hw_light, a change of
+// the level alone only scales the vector
+typedef struct {
+    bool valid;
+    uint8_t color_mode;
+    uint16_t color[2];      // chromaticity x and y, or hue and saturation in HSV
+    uint16_t full_master;   // strongest channel of the color at level 255
+} _color_vector_t;
+
 typedef struct {
     cluster_init_counter_t init_counters;
     bool external_updates_disabled;
+    uint8_t dirty;
+    uint8_t fading;     // endpoints whose level transition runs in hardware, LLIGHT_EP_BIT()
+    uint32_t color_synced_ms;
+    sl_zigbee_event_t render_event;
+    sl_zigbee_event_t reconcile_event;
+    _shadow_state_t shadow;
+    _keyframes_t keyframes;
+    _color_vector_t vector;
 } Llight_state_t;
 
 static Llight_state_t _state = {
@@ -38,7 +162,13 @@ static Llight_state_t _state = {
         .on_off = CLUSTERS_TO_INIT_ON_OFF,
         .level = CLUSTERS_TO_INIT_LEVEL
     },
-    .external_updates_disabled = true
+    .external_updates_disabled = true,
+    .dirty = 0,
+    .fading = 0,
+    .color_synced_ms = 0,
+    .shadow = { .valid = false },
+    .keyframes = { .valid = false },
+    .vector = { .valid = false }
 };
 
 
@@ -47,10 +177,43 @@ static Llight_state_t _state = {
 static void _sync_hardware_state(void);
 static sl_status_t _sync_light_channel(uint8_t endpoint, enum RGB_channel_name_t ch_name);
 static sl_status_t _sync_channel_light_to_color(void);
-static sl_status_t _sync_color_brightness_to_channels( uint8_t level );
-static EmberAfStatus _rgb_from_xy_and_brightness(uint8_t *red, uint8_t *green, uint8_t *blue);
+static sl_status_t _sync_color_brightness_to_channels(void);
+static sl_status_t _render_color_vector(void);
+static sl_status_t _output_color(const uint16_t intensity[CHANNEL_ENDPOINT_COUNT], bool publish_channels);
+static sl_status_t _publish_channels(const uint16_t intensity[CHANNEL_ENDPOINT_COUNT]);
+static EmberAfStatus _rgb_from_xy_and_brightness(uint16_t *red, uint16_t *green, uint16_t *blue);
+static void _render_xy_level(uint16_t color_x, uint16_t color_y, uint8_t level,
+                             uint16_t *red, uint16_t *green, uint16_t *blue);
+static void _render_hsv_level(uint16_t hue, uint8_t saturation, uint8_t level,
+                              uint16_t *red, uint16_t *green, uint16_t *blue);
+static void _keyframes_move(_motion_t *motion, uint16_t current, uint16_t target, uint32_t transition_ms);
+static void _keyframes_build(void);
+static uint16_t _step_xy(uint16_t value, int16_t step);
+#if HW_LIGHT_MIX_POWER_OPTIMAL
+static void _mix_power_optimal(uint16_t *color_x, uint16_t *color_y, uint8_t level);
+#endif // HW_LIGHT_MIX_POWER_OPTIMAL
+static bool _keyframes_render(uint16_t *red, uint16_t *green, uint16_t *blue);
+#if defined(SL_CATALOG_ZIGBEE_SCENES_PRESENT) && defined(ZCL_USING_COLOR_CONTROL_CLUSTER_SERVER)
+static bool _scene_color_xy(uint16_t group_id, uint8_t scene_id,
+                            uint16_t *color_x, uint16_t *color_y, uint32_t *transition_ms);
+#endif // SL_CATALOG_ZIGBEE_SCENES_PRESENT && ZCL_USING_COLOR_CONTROL_CLUSTER_SERVER
 static sl_status_t _turn_onoff_light(uint8_t endpoint, bool turn_on);
 static sl_status_t _update_xy_color_from_rgb(uint8_t red, uint8_t green, uint8_t blue);
+static void _mark_color_dirty(void);
+static void _mark_channels_dirty(void);
+static void _reconcile_channels_to_color(void);
+static void _reconcile_event_handler(sl_zigbee_event_t *event);
+static sl_status_t _shadow_load(void);
+static _ep_shadow_t *_shadow_ep(uint8_t endpoint);
+static sl_status_t _get_onoff(uint8_t endpoint, uint8_t *on_off);
+static sl_status_t _get_level(uint8_t endpoint, uint8_t *level);
+static sl_status_t _get_color_xy(uint16_t *color_x, uint16_t *color_y);
+static sl_status_t _get_color_temp(uint8_t *color_mode, uint16_t *mireds);
+static sl_status_t _get_chromaticity(uint16_t *color_x, uint16_t *color_y);
+static sl_status_t _read_hsv_attributes(_hsv_attributes_t *hsv);
+static sl_status_t _get_color_hsv(uint16_t *hue, uint8_t *saturation);
+static void _render_event_handler(sl_zigbee_event_t *event);
+static bool _endpoint_to_channel(uint8_t endpoint, enum RGB_channel_name_t *ch_name);
 
 
 // Callback implementations
@@ -77,10 +240,11 @@ void emberAfPluginLevelControlClusterServerPostInitCallback(uint8_t endpoint)
  */
 void emberAfPluginColorControlServerComputePwmFromHsvCallback(uint8_t endpoint)
 {
-    if ( _state.external_updates_disabled ) return;
+    if ( _state.external_updates_disabled || (EP_RGB_LIGHT != endpoint) ) return;
     llight_disable_external_updates();
-    emberAfColorControlClusterPrintln("%d Updating temperature from HSV", TIMESTAMP_MS);
 
+    emberAfColorControlClusterPrintln("%d Updating RGB from HSV", TIMESTAMP_MS);
+    _mark_color_dirty();
 
     llight_enable_external_updates();
 }
@@ -98,7 +262,26 @@ void emberAfPluginColorControlServerComputePwmFromXyCallback(uint8_t endpoint)
     llight_disable_external_updates();
 
     emberAfColorControlClusterPrintln("%d Updating RGB from XY", TIMESTAMP_MS);
-    _sync_color_brightness_to_channels(endpoint);
+    _mark_color_dirty();
+
+    llight_enable_external_updates();
+}
+
+/** @brief Compute Pwm from color temperature
+ *
+ * This function is called from the color server when it is time for the PWMs to
+ * be driven with a new value from the color temperature. The mireds are rendered
+ * through their point on the Planckian locus, the same way as an xy color.
+ *
+ * @param endpoint The identifying endpoint Ver.: always
+ */
+void emberAfPluginColorControlServerComputePwmFromTempCallback(uint8_t endpoint)
+{
+    if ( _state.external_updates_disabled || (EP_RGB_LIGHT != endpoint) ) return;
+    llight_disable_external_updates();
+
+    emberAfColorControlClusterPrintln("%d Updating RGB from color temperature", TIMESTAMP_MS);
+    _mark_color_dirty();
 
     llight_enable_external_updates();
 }
@@ -106,6 +289,26 @@ void emberAfPluginColorControlServerComputePwmFromXyCallback(uint8_t endpoint)
 // *****************************
 // Public method implementations
 // -----------------------------
+/**
+ * @brief initialize the logical light, must be called before the clusters are running
+ */
+void llight_init(void)
+{
+    sl_zigbee_event_init( &_state.render_event, _render_event_handler );
+    sl_zigbee_event_init( &_state.reconcile_event, _reconcile_event_handler );
+    color_loop_init( EP_RGB_LIGHT );
+    light_energy_init( EP_RGB_LIGHT );
+}
+
+/**
+ * @brief reconcile the channel endpoints changes into the color light, called once per
+ *        main loop pass
+ */
+void llight_tick(void)
+{
+    _reconcile_channels_to_color();
+}
+
 /**
  * @brief ignore update to the light state based on post attribute changes, this allows the
  *        other method to update the "linked state", e.g. red/green/blue channel lights to RGB
@@ -126,6 +329,64 @@ void llight_enable_external_updates(void)
     _state.external_updates_disabled = false;
 }
 
+/**
+ * @brief keep the light state shadow coherent, must be called from the post attribute
+ *        change callback for every server attribute change
+ */
+void llight_attribute_changed(uint8_t endpoint,
+                              EmberAfClusterId clusterId,
+                              EmberAfAttributeId attributeId,
+                              uint8_t *value)
+{
+    _ep_shadow_t *shadow = _shadow_ep( endpoint );
+    if ( NULL == shadow ) return;
+
+    if ( (ZCL_ON_OFF_CLUSTER_ID == clusterId) && (ZCL_ON_OFF_ATTRIBUTE_ID == attributeId) ) {
+        shadow->on_off = value[0];
+        LIGHT_TRACE( LIGHT_TRACE_EVT_ONOFF, endpoint, value[0] );
+        // the color light comes on from a command or from a channel endpoint turned on
+        if ( (EP_RGB_LIGHT == endpoint) && value[0] ) color_loop_resume();
+    } else if ( (ZCL_LEVEL_CONTROL_CLUSTER_ID == clusterId)
+                && (ZCL_CURRENT_LEVEL_ATTRIBUTE_ID == attributeId) ) {
+        shadow->level = value[0];
+        LIGHT_TRACE( LIGHT_TRACE_EVT_LEVEL, endpoint, value[0] );
+    } else if ( (EP_RGB_LIGHT == endpoint) && (ZCL_COLOR_CONTROL_CLUSTER_ID == clusterId) ) {
+        if ( ZCL_COLOR_CONTROL_CURRENT_X_ATTRIBUTE_ID == attributeId ) {
+            MEMCOPY( &_state.shadow.color_x, value, sizeof(_state.shadow.color_x) );
+            LIGHT_TRACE( LIGHT_TRACE_EVT_COLOR_X, endpoint, _state.shadow.color_x );
+        } else if ( ZCL_COLOR_CONTROL_CURRENT_Y_ATTRIBUTE_ID == attributeId ) {
+            MEMCOPY( &_state.shadow.color_y, value, sizeof(_state.shadow.color_y) );
+            LIGHT_TRACE( LIGHT_TRACE_EVT_COLOR_Y, endpoint, _state.shadow.color_y );
+        } else if ( ZCL_COLOR_CONTROL_COLOR_TEMPERATURE_ATTRIBUTE_ID == attributeId ) {
+            MEMCOPY( &_state.shadow.color_temp_mireds, value, sizeof(_state.shadow.color_temp_mireds) );
+        } else if ( ZCL_COLOR_CONTROL_COLOR_MODE_ATTRIBUTE_ID == attributeId ) {
+            _state.shadow.color_mode = value[0];
+            if ( LLIGHT_COLOR_MODE_HSV != value[0] ) color_loop_cancel();
+        } else if ( ZCL_COLOR_CONTROL_CURRENT_HUE_ATTRIBUTE_ID == attributeId ) {
+            _state.shadow.hsv.current_hue = value[0];
+        } else if ( ZCL_COLOR_CONTROL_ENHANCED_CURRENT_HUE_ATTRIBUTE_ID == attributeId ) {
+            MEMCOPY( &_state.shadow.hsv.enhanced_hue, value, sizeof(_state.shadow.hsv.enhanced_hue) );
+        } else if ( ZCL_COLOR_CONTROL_CURRENT_SATURATION_ATTRIBUTE_ID == attributeId ) {
+            _state.shadow.hsv.saturation = value[0];
+        } else if ( ZCL_COLOR_CONTROL_ENHANCED_COLOR_MODE_ATTRIBUTE_ID == attributeId ) {
+            _state.shadow.hsv.enhanced_color_mode = value[0];
+        }
+    }
+}
+
+/**
+ * @brief get on/off state of a light endpoint
+ * @param[in] endpoint
+ * @param[out] on_off
+ * @return    Status Code:
+ *            - SL_STATUS_OK   Success
+ *            - SL_STATUS_FAIL Error
+ */
+sl_status_t llight_get_onoff(uint8_t endpoint, uint8_t *on_off)
+{
+    return _get_onoff( endpoint, on_off );
+}
+
 /**
  * @brief turn on the light RGB or individual channel based on the endpoint. The method
  *        would take care updating the linked state lights.
@@ -165,32 +426,175 @@ sl_status_t llight_set_level(uint8_t endpoint, uint8_t level)
 
     sl_status_t status = SL_STATUS_FAIL;
 
-    switch ( endpoint ) {
-        case EP_RED_CHANNEL:
-            status = hw_light_set_level_ch( CH_RED, level );
-            _sync_channel_light_to_color();
-            break;
+    // the hardware is on its way to the transition target already
+    if ( _state.fading & LLIGHT_EP_BIT( endpoint ) ) {
+        _mark_channels_dirty();
+        llight_enable_external_updates();
+        return SL_STATUS_OK;
+    }
+
+    enum RGB_channel_name_t ch_name;
+    if ( _endpoint_to_channel( endpoint, &ch_name ) ) {
+        status = hw_light_set_level_ch( ch_name, LEVEL_TO_INTENSITY( level ) );
+        _mark_channels_dirty();
+    } else if ( EP_RGB_LIGHT == endpoint ) {
+        _mark_color_dirty();
+        status = SL_STATUS_OK;
+    }
 
-        case EP_GREEN_CHANNEL:
-            status = hw_light_set_level_ch( CH_GREEN, level );
-            _sync_channel_light_to_color();
-            break;
+    llight_enable_external_updates();
+    return status;
+}
 
-        case EP_BLUE_CHANNEL:
-            status = hw_light_set_level_ch( CH_BLUE, level );
-            _sync_channel_light_to_color();
-            break;
+/**
+ * @brief start of a level transition. A channel endpoint is handed to the hardware,
+ *        while it runs the level steps written by level control are not applied. The
+ *        color light gets its transition keyframes rendered up front
+ * @param[in] endpoint -- endpoint of the transition
+ * @param[in] level -- target level
+ * @param[in] transition_ms -- transition time
+ * @return true if the hardware fades the channel, false to step it in software
+ */
+bool llight_fade_start(uint8_t endpoint, uint8_t level, uint32_t transition_ms)
+{
+    enum RGB_channel_name_t ch_name;
 
-        case EP_RGB_LIGHT:
-            status = _sync_color_brightness_to_channels( level );
-            break;
+    if ( EP_RGB_LIGHT == endpoint && _state.shadow.valid ) {
+        _keyframes_move( &_state.keyframes.level, _state.shadow.ep[0].level, level, transition_ms );
+        _keyframes_build();
+        return false;
+    }
+    if ( !_endpoint_to_channel( endpoint, &ch_name ) ) return false;
 
-        default:
-            break;
+    _state.fading &= ~LLIGHT_EP_BIT( endpoint );
+    if ( SL_STATUS_OK != hw_light_fade_ch( ch_name, LEVEL_TO_INTENSITY( level ), transition_ms ) ) {
+        return false;
     }
+    _state.fading |= LLIGHT_EP_BIT( endpoint );
+    return true;
+}
 
-    llight_enable_external_updates();
-    return status;
+/**
+ * @brief end of a level transition, stops the hardware fade if there was one and
+ *        applies the final level
+ * @param[in] endpoint -- endpoint of the transition
+ */
+void llight_fade_end(uint8_t endpoint)
+{
+    enum RGB_channel_name_t ch_name;
+    uint8_t level;
+
+    if ( !(_state.fading & LLIGHT_EP_BIT( endpoint )) ) return;
+    _state.fading &= ~LLIGHT_EP_BIT( endpoint );
+    if ( !_endpoint_to_channel( endpoint, &ch_name ) ) return;
+    if ( SL_STATUS_OK != _get_level( endpoint, &level ) ) return;
+    hw_light_set_level_ch( ch_name, LEVEL_TO_INTENSITY( level ) );
+}
+
+/**
+ * @brief a level transition was interrupted by Stop or a new command. The hardware fade
+ *        stops where it is and CurrentLevel, which level control only updates every few
+ *        hundred ms during a hardware fade, is brought to the level it got to, so the next
+ *        transition starts from the actual output
+ * @param[in] endpoint -- endpoint of the transition
+ */
+void llight_fade_cancel(uint8_t endpoint)
+{
+    enum RGB_channel_name_t ch_name;
+    uint16_t intensity;
+
+    if ( !(_state.fading & LLIGHT_EP_BIT( endpoint )) ) return;
+    _state.fading &= ~LLIGHT_EP_BIT( endpoint );
+    if ( !_endpoint_to_channel( endpoint, &ch_name ) ) return;
+    if ( SL_STATUS_OK != hw_light_fade_stop_ch( ch_name, &intensity ) ) return;
+
+    uint8_t level = INTENSITY_TO_LEVEL( intensity );
+    bool external_updates_disabled = _state.external_updates_disabled;
+    llight_disable_external_updates();
+    (void) emberAfWriteServerAttribute( endpoint, ZCL_LEVEL_CONTROL_CLUSTER_ID, ZCL_CURRENT_LEVEL_ATTRIBUTE_ID,
+                                        &level, ZCL_INT8U_ATTRIBUTE_TYPE );
+    _state.external_updates_disabled = external_updates_disabled;
+    _mark_channels_dirty();
+}
+
+/**
+ * @brief render the color light right away, for effects driving it frame by frame
+ * @param[in] publish_channels -- also write the levels to the channel endpoints, without
+ *            only the hardware follows
+ */
+void llight_render_color(bool publish_channels)
+{
+    uint16_t intensity[CHANNEL_ENDPOINT_COUNT];
+    uint8_t on_off;
+
+    if ( (SL_STATUS_OK != _get_onoff( EP_RGB_LIGHT, &on_off )) || !on_off ) return;
+
+    bool external_updates_disabled = _state.external_updates_disabled;
+    llight_disable_external_updates();
+    if ( SL_STATUS_OK == _rgb_from_xy_and_brightness( &intensity[0], &intensity[1], &intensity[2] ) ) {
+        _output_color( intensity, publish_channels );
+    }
+    _state.external_updates_disabled = external_updates_disabled;
+}
+
+/**
+ * @brief look for color light transitions with a known end in an incoming command and
+ *        render their keyframes, must be called before the command is processed
+ * @param[in] cmd -- incoming ZCL command
+ */
+void llight_command_received(const EmberAfClusterCommand *cmd)
+{
+    uint16_t color_x, color_y, mireds;
+    uint32_t transition_ms;
+    uint16_t idx = cmd->payloadStartIndex;
+
+    if ( (EP_RGB_LIGHT != cmd->apsFrame->destinationEndpoint) || cmd->mfgSpecific ) return;
+    if ( !_state.shadow.valid ) return;
+
+    if ( (ZCL_COLOR_CONTROL_CLUSTER_ID == cmd->apsFrame->clusterId)
+         && (ZCL_MOVE_TO_COLOR_TEMPERATURE_COMMAND_ID == cmd->commandId) ) {
+        if ( cmd->bufLen < idx + 4 ) return;
+        mireds = emberAfGetInt16u( cmd->buffer, idx, cmd->bufLen );
+        transition_ms = emberAfGetInt16u( cmd->buffer, idx + 2, cmd->bufLen ) * 100UL;
+        if ( 0 == transition_ms ) return;
+        _keyframes_move( &_state.keyframes.mireds, _state.shadow.color_temp_mireds, mireds, transition_ms );
+        _state.keyframes.color_mode = LLIGHT_COLOR_MODE_TEMPERATURE;
+        _keyframes_build();
+        return;
+    } else if ( ZCL_COLOR_CONTROL_CLUSTER_ID == cmd->apsFrame->clusterId ) {
+        if ( cmd->bufLen < idx + 6 ) return;
+        if ( ZCL_MOVE_TO_COLOR_COMMAND_ID == cmd->commandId ) {
+            color_x = emberAfGetInt16u( cmd->buffer, idx, cmd->bufLen );
+            color_y = emberAfGetInt16u( cmd->buffer, idx + 2, cmd->bufLen );
+        } else if ( ZCL_STEP_COLOR_COMMAND_ID == cmd->commandId ) {
+            color_x = _step_xy( _state.shadow.color_x, (int16_t) emberAfGetInt16u( cmd->buffer, idx, cmd->bufLen ) );
+            color_y = _step_xy( _state.shadow.color_y, (int16_t) emberAfGetInt16u( cmd->buffer, idx + 2, cmd->bufLen ) );
+        } else {
+            return;
+        }
+        transition_ms = emberAfGetInt16u( cmd->buffer, idx + 4, cmd->bufLen ) * 100UL;
+#if defined(SL_CATALOG_ZIGBEE_SCENES_PRESENT) && defined(ZCL_USING_COLOR_CONTROL_CLUSTER_SERVER)
+    } else if ( (ZCL_SCENES_CLUSTER_ID == cmd->apsFrame->clusterId)
+                && (ZCL_RECALL_SCENE_COMMAND_ID == cmd->commandId) ) {
+        if ( cmd->bufLen < idx + 3 ) return;
+        if ( !_scene_color_xy( emberAfGetInt16u( cmd->buffer, idx, cmd->bufLen ),
+                               emberAfGetInt8u( cmd->buffer, idx + 2, cmd->bufLen ),
+                               &color_x, &color_y, &transition_ms ) ) return;
+        // the optional transition time of the command overrides the one of the scene
+        if ( cmd->bufLen >= idx + 5 ) {
+            uint16_t transition_ds = emberAfGetInt16u( cmd->buffer, idx + 3, cmd->bufLen );
+            if ( 0xFFFF != transition_ds ) transition_ms = transition_ds * 100UL;
+        }
+#endif // SL_CATALOG_ZIGBEE_SCENES_PRESENT && ZCL_USING_COLOR_CONTROL_CLUSTER_SERVER
+    } else {
+        return;
+    }
+
+    if ( 0 == transition_ms ) return;
+    _keyframes_move( &_state.keyframes.color_x, _state.shadow.color_x, color_x, transition_ms );
+    _keyframes_move( &_state.keyframes.color_y, _state.shadow.color_y, color_y, transition_ms );
+    _state.keyframes.color_mode = LLIGHT_COLOR_MODE_XY;
+    _keyframes_build();
 }
 
 // *****************************
@@ -208,9 +612,12 @@ static void _sync_hardware_state(void)
     }
 
     sl_zigbee_app_debug_println("%d: Light is initialized, sync hardware state", TIMESTAMP_MS);
-    _sync_light_channel( EP_RED_CHANNEL, CH_RED );
-    _sync_light_channel( EP_GREEN_CHANNEL, CH_GREEN );
-    _sync_light_channel( EP_BLUE_CHANNEL, CH_BLUE );
+    if ( SL_STATUS_OK != _shadow_load() ) {
+        sl_zigbee_app_debug_println("%d: Couldn't load the light state, using the attribute table", TIMESTAMP_MS);
+    }
+    for ( uint8_t i = 0; i < CHANNEL_ENDPOINT_COUNT; i++ ) {
+        _sync_light_channel( _channel_endpoints[i].endpoint, _channel_endpoints[i].ch_name );
+    }
 
     _sync_channel_light_to_color();
     _state.external_updates_disabled = false;
@@ -228,26 +635,16 @@ static void _sync_hardware_state(void)
 static sl_status_t _sync_light_channel(uint8_t endpoint, enum RGB_channel_name_t ch_name)
 {
     uint8_t on_off, level;
-    if (emberAfReadServerAttribute(endpoint,
-                                   ZCL_LEVEL_CONTROL_CLUSTER_ID,
-                                   ZCL_CURRENT_LEVEL_ATTRIBUTE_ID,
-                                   (uint8_t *) &level,
-                                   sizeof(level))
-        != EMBER_ZCL_STATUS_SUCCESS) {
+    if ( SL_STATUS_OK != _get_level( endpoint, &level ) ) {
         sl_zigbee_app_debug_println("%d Couldn't sync level for endpoint %d", TIMESTAMP_MS, endpoint);
         return SL_STATUS_FAIL;
     }
-    if (emberAfReadServerAttribute(endpoint,
-                                   ZCL_ON_OFF_CLUSTER_ID,
-                                   ZCL_ON_OFF_ATTRIBUTE_ID,
-                                   (uint8_t *) &on_off,
-                                   sizeof(on_off))
-        != EMBER_ZCL_STATUS_SUCCESS) {
+    if ( SL_STATUS_OK != _get_onoff( endpoint, &on_off ) ) {
         sl_zigbee_app_debug_println("%d Couldn't sync on_off for endpoint %d", TIMESTAMP_MS, endpoint);
         return SL_STATUS_FAIL;
     }
 
-    hw_light_set_level_ch( ch_name, level );
+    hw_light_set_level_ch( ch_name, LEVEL_TO_INTENSITY( level ) );
     if ( on_off ) {
         hw_light_turn_on_ch( ch_name );
     } else {
@@ -265,26 +662,17 @@ static sl_status_t _sync_color_light_to_channels(void)
 {
     uint8_t onoff;
     // Get RGB light on_off
-    if (emberAfReadServerAttribute(EP_RGB_LIGHT,
-                                   ZCL_ON_OFF_CLUSTER_ID,
-                                   ZCL_ON_OFF_ATTRIBUTE_ID,
-                                   (uint8_t *) &onoff,
-                                   sizeof(uint8_t))
-        != EMBER_ZCL_STATUS_SUCCESS) {
-        return SL_STATUS_FAIL;
-    }
+    if ( SL_STATUS_OK != _get_onoff( EP_RGB_LIGHT, &onoff ) ) return SL_STATUS_FAIL;
 
-    uint8_t ch_endpoints[] = {EP_RED_CHANNEL, EP_GREEN_CHANNEL, EP_BLUE_CHANNEL};
-
-    for (uint8_t i = 0; i < (sizeof(ch_endpoints)/sizeof(ch_endpoints[0])); i++) {
+    for (uint8_t i = 0; i < CHANNEL_ENDPOINT_COUNT; i++) {
         if ( EMBER_ZCL_STATUS_SUCCESS != emberAfWriteServerAttribute(
-            ch_endpoints[i],
+            _channel_endpoints[i].endpoint,
             ZCL_ON_OFF_CLUSTER_ID,
             ZCL_ON_OFF_ATTRIBUTE_ID,
             (uint8_t *) &onoff,
             ZCL_BOOLEAN_ATTRIBUTE_TYPE
         )) return SL_STATUS_FAIL;
-        emberAfOnOffClusterPrintln("%d Setting CH %d on_off to %d", TIMESTAMP_MS, ch_endpoints[i], onoff);
+        emberAfOnOffClusterPrintln("%d Setting CH %d on_off to %d", TIMESTAMP_MS, _channel_endpoints[i].endpoint, onoff);
     }
 
     // ToDo sync color to channel levels
@@ -322,22 +710,8 @@ static sl_status_t _sync_channel_light_to_color(void)
 
     // Read level and on_off for each channel
     for (uint8_t i = 0; i < (sizeof(init)/sizeof(init[0])); i++) {
-        if (emberAfReadServerAttribute(init[i].endpoint,
-                                       ZCL_LEVEL_CONTROL_CLUSTER_ID,
-                                       ZCL_CURRENT_LEVEL_ATTRIBUTE_ID,
-                                       (uint8_t *) (init[i].level),
-                                       sizeof(uint8_t))
-            != EMBER_ZCL_STATUS_SUCCESS) {
-            return SL_STATUS_FAIL;
-        }
-        if (emberAfReadServerAttribute(init[i].endpoint,
-                                       ZCL_ON_OFF_CLUSTER_ID,
-                                       ZCL_ON_OFF_ATTRIBUTE_ID,
-                                       (uint8_t *) (init[i].onoff),
-                                       sizeof(uint8_t))
-            != EMBER_ZCL_STATUS_SUCCESS) {
-            return SL_STATUS_FAIL;
-        }
+        if ( SL_STATUS_OK != _get_level( init[i].endpoint, init[i].level ) ) return SL_STATUS_FAIL;
+        if ( SL_STATUS_OK != _get_onoff( init[i].endpoint, init[i].onoff ) ) return SL_STATUS_FAIL;
         emberAfOnOffClusterPrintln("%d Endpoint: %d, channel: %d, on_off: %d, level: %d",
             TIMESTAMP_MS, init[i].endpoint, init[i].ch_name, (uint8_t) *(init[i].onoff), (uint8_t) *(init[i].level));
     }
@@ -366,63 +740,199 @@ static sl_status_t _sync_channel_light_to_color(void)
 sl_status_t _turn_onoff_light(uint8_t endpoint, bool turn_on)
 {
     sl_status_t state = SL_STATUS_OK;
-    switch ( endpoint ) {
-        case EP_RED_CHANNEL:
-            state = hw_light_turn_ch_onoff( CH_RED, turn_on );
-            _sync_channel_light_to_color();
-            break; 
-
-        case EP_GREEN_CHANNEL:
-            state = hw_light_turn_ch_onoff( CH_GREEN, turn_on );
-            _sync_channel_light_to_color();
-            break; 
-
-        case EP_BLUE_CHANNEL:
-            state = hw_light_turn_ch_onoff( CH_BLUE, turn_on );
-            _sync_channel_light_to_color();
-            break; 
-
-        case EP_RGB_LIGHT:
-            if ( turn_on ) {
-                hw_light_turnon();
-            } else {
-                hw_light_turnoff();
-            }
-            _sync_color_light_to_channels();
-            break; 
-
-        default:
-            state = SL_STATUS_FAIL;
-            break;
+    enum RGB_channel_name_t ch_name;
+
+    if ( _endpoint_to_channel( endpoint, &ch_name ) ) {
+        state = hw_light_turn_ch_onoff( ch_name, turn_on );
+        _mark_channels_dirty();
+    } else if ( EP_RGB_LIGHT == endpoint ) {
+        if ( turn_on ) {
+            hw_light_turnon();
+        } else {
+            hw_light_turnoff();
+        }
+        _sync_color_light_to_channels();
+    } else {
+        state = SL_STATUS_FAIL;
     }
 
     return state;
 }
 
+/**
+ * @brief the color light level or xy changed, render it with the next frame
+ */
+static void _mark_color_dirty(void)
+{
+    _state.dirty = LLIGHT_DIRTY_COLOR;
+    if ( !sl_zigbee_event_is_scheduled( &_state.render_event ) ) {
+        sl_zigbee_event_set_delay_ms( &_state.render_event, LLIGHT_RENDER_FRAME_MS );
+    }
+}
+
+/**
+ * @brief frame compositor, renders the latest level and xy of the color light once
+ */
+static void _render_event_handler(sl_zigbee_event_t *event)
+{
+    sl_zigbee_event_set_inactive( event );
+    if ( !(_state.dirty & LLIGHT_DIRTY_COLOR) ) return;
+    _state.dirty &= ~LLIGHT_DIRTY_COLOR;
+    LIGHT_TRACE( LIGHT_TRACE_EVT_RENDER, EP_RGB_LIGHT, 0 );
+
+    bool external_updates_disabled = _state.external_updates_disabled;
+    llight_disable_external_updates();
+    _sync_color_brightness_to_channels();
+    _state.external_updates_disabled = external_updates_disabled;
+}
+
+/**
+ * @brief a channel endpoint changed, the color light is re-derived by the reconciliation
+ */
+static void _mark_channels_dirty(void)
+{
+    _state.dirty = LLIGHT_DIRTY_CHANNELS;
+}
+
+/**
+ * @brief derive the color light from the latest channels state, once for any number
+ *        of channel changes and no more often than LLIGHT_COLOR_SYNC_INTERVAL_MS
+ */
+static void _reconcile_channels_to_color(void)
+{
+    if ( !(_state.dirty & LLIGHT_DIRTY_CHANNELS) ) return;
+
+    uint32_t since_ms = TIMESTAMP_MS - _state.color_synced_ms;
+    if ( since_ms < LLIGHT_COLOR_SYNC_INTERVAL_MS ) {
+        // the main loop may not run again before the device sleeps, make sure it wakes up
+        if ( !sl_zigbee_event_is_scheduled( &_state.reconcile_event ) ) {
+            sl_zigbee_event_set_delay_ms( &_state.reconcile_event,
+                                          LLIGHT_COLOR_SYNC_INTERVAL_MS - since_ms );
+        }
+        return;
+    }
+
+    _state.dirty &= ~LLIGHT_DIRTY_CHANNELS;
+    _state.color_synced_ms = TIMESTAMP_MS;
+    sl_zigbee_event_set_inactive( &_state.reconcile_event );
+    LIGHT_TRACE( LIGHT_TRACE_EVT_RECONCILE, EP_RGB_LIGHT, 0 );
+
+    bool external_updates_disabled = _state.external_updates_disabled;
+    llight_disable_external_updates();
+    _sync_channel_light_to_color();
+    _state.external_updates_disabled = external_updates_disabled;
+}
+
+static void _reconcile_event_handler(sl_zigbee_event_t *event)
+{
+    sl_zigbee_event_set_inactive( event );
+    _reconcile_channels_to_color();
+}
+
 /**
  * @brief recalculate RGB from XY, normalize to brighntess and update channels
  */
-static sl_status_t _sync_color_brightness_to_channels(uint8_t endpoint)
+static sl_status_t _sync_color_brightness_to_channels(void)
 {
-    struct {
-        uint8_t ep;
-        enum RGB_channel_name_t chname;
-        uint8_t level;
-    } levels[] = {
-        {.ep = EP_RED_CHANNEL, .chname = CH_RED, },
-        {.ep = EP_GREEN_CHANNEL, .chname = CH_GREEN, },
-        {.ep = EP_BLUE_CHANNEL, .chname = CH_BLUE }
-    };
+    uint16_t intensity[CHANNEL_ENDPOINT_COUNT];
 
-    sl_status_t status;
-    status = _rgb_from_xy_and_brightness( &(levels[0].level), &(levels[1].level), &(levels[2].level) );
+    if ( _keyframes_render( &intensity[0], &intensity[1], &intensity[2] ) ) return _output_color( intensity, true );
+    if ( SL_STATUS_OK == _render_color_vector() ) {
+        hw_light_get_rgbcolor( &intensity[0], &intensity[1], &intensity[2] );
+        return _publish_channels( intensity );
+    }
+
+    sl_status_t status = _rgb_from_xy_and_brightness( &intensity[0], &intensity[1], &intensity[2] );
     if ( SL_STATUS_OK != status ) return status;
+    return _output_color( intensity, true );
+}
+
+/**
+ * @brief render the color light as a color vector and a brightness in hw_light. The color
+ *        is only converted when it changed, a change of the level alone scales the vector
+ *        of the last one. Only done where a dimmed color is the color at level 255 scaled
+ *        down, which with the linear curve the gamma encoded xy colors are not
+ * @return    Status Code:
+ *            - SL_STATUS_OK   Rendered
+ *            - SL_STATUS_NOT_SUPPORTED The color has to be rendered at the level
+ *            - SL_STATUS_FAIL Error
+ */
+static sl_status_t _render_color_vector(void)
+{
+    uint16_t color[2], full[3], mireds;
+    uint8_t level, color_mode, saturation;
+
+    if ( SL_STATUS_OK != _get_level( EP_RGB_LIGHT, &level ) ) return SL_STATUS_FAIL;
+    if ( SL_STATUS_OK != _get_color_temp( &color_mode, &mireds ) ) return SL_STATUS_FAIL;
+    if ( LLIGHT_COLOR_MODE_HSV == color_mode ) {
+        // a running color loop renders every frame itself
+        if ( color_loop_hue( &color[0] ) ) return SL_STATUS_NOT_SUPPORTED;
+        if ( SL_STATUS_OK != _get_color_hsv( &color[0], &saturation ) ) return SL_STATUS_FAIL;
+        color[1] = saturation;
+    } else {
+#if HW_LIGHT_DIMMING_CURVE == DIMMING_CURVE_LINEAR
+        return SL_STATUS_NOT_SUPPORTED;
+#else
+        if ( SL_STATUS_OK != _get_chromaticity( &color[0], &color[1] ) ) return SL_STATUS_FAIL;
+#endif // HW_LIGHT_DIMMING_CURVE
+    }
 
-    for ( uint8_t i = 0; i < (sizeof( levels )/sizeof( levels[0] )); i++) {
-        status |= hw_light_set_level_ch( levels[i].chname, levels[i].level );
+    // hw_light refuses when the channels were written by anything else since
+    if ( _state.vector.valid && (color_mode == _state.vector.color_mode)
+         && (color[0] == _state.vector.color[0]) && (color[1] == _state.vector.color[1])
+         && (SL_STATUS_OK == hw_light_set_brightness( dimming_apply( _state.vector.full_master, level ) )) ) {
+        return SL_STATUS_OK;
+    }
+
+    if ( LLIGHT_COLOR_MODE_HSV == color_mode ) {
+        _render_hsv_level( color[0], saturation, 0xFF, &full[0], &full[1], &full[2] );
+    } else {
+        _render_xy_level( color[0], color[1], 0xFF, &full[0], &full[1], &full[2] );
+    }
+    _state.vector.valid = true;
+    _state.vector.color_mode = color_mode;
+    _state.vector.color[0] = color[0];
+    _state.vector.color[1] = color[1];
+    _state.vector.full_master = 0;
+    for ( uint8_t i = 0; i < 3; i++ ) {
+        if ( full[i] > _state.vector.full_master ) _state.vector.full_master = full[i];
+    }
+    hw_light_set_color_vector( full[0], full[1], full[2], dimming_apply( _state.vector.full_master, level ) );
+    return SL_STATUS_OK;
+}
+
+/**
+ * @brief drive the channels with the rendered color light
+ * @param[in] intensity -- channel intensities in the order of _channel_endpoints
+ * @param[in] publish_channels -- also write the levels to the channel endpoints
+ */
+static sl_status_t _output_color(const uint16_t intensity[CHANNEL_ENDPOINT_COUNT], bool publish_channels)
+{
+    sl_status_t status = SL_STATUS_OK;
+
+    // all the channels of a color change go out in the same PWM period
+    for ( uint8_t i = 0; i < CHANNEL_ENDPOINT_COUNT; i++ ) {
+        status |= hw_light_stage_level_ch( _channel_endpoints[i].ch_name, intensity[i] );
+    }
+    hw_light_commit();
+    if ( !publish_channels ) return status;
+
+    return status | _publish_channels( intensity );
+}
+
+/**
+ * @brief write the levels of the rendered color light to the channel endpoints
+ * @param[in] intensity -- channel intensities in the order of _channel_endpoints
+ */
+static sl_status_t _publish_channels(const uint16_t intensity[CHANNEL_ENDPOINT_COUNT])
+{
+    sl_status_t status = SL_STATUS_OK;
+
+    for ( uint8_t i = 0; i < CHANNEL_ENDPOINT_COUNT; i++ ) {
+        uint8_t level = INTENSITY_TO_LEVEL( intensity[i] );
         if ( EMBER_ZCL_STATUS_SUCCESS != emberAfWriteServerAttribute(
-            levels[i].ep, ZCL_LEVEL_CONTROL_CLUSTER_ID, ZCL_CURRENT_LEVEL_ATTRIBUTE_ID,
-            &(levels[i].level),
+            _channel_endpoints[i].endpoint, ZCL_LEVEL_CONTROL_CLUSTER_ID, ZCL_CURRENT_LEVEL_ATTRIBUTE_ID,
+            &level,
             ZCL_INT8U_ATTRIBUTE_TYPE
         )) status |= SL_STATUS_FAIL;
     }
@@ -431,105 +941,124 @@ static sl_status_t _sync_color_brightness_to_channels(uint8_t endpoint)
 }
 
 /**
- * @brief calclulate rgb from X & Y color, normilized to current brightness
+ * @brief calclulate rgb from the color of the ColorMode, normilized to current brightness
  */
-static EmberAfStatus _rgb_from_xy_and_brightness(uint8_t *red, uint8_t *green, uint8_t *blue) {
+static EmberAfStatus _rgb_from_xy_and_brightness(uint16_t *red, uint16_t *green, uint16_t *blue) {
     uint16_t color_x, color_y;
-    uint8_t level;
+    uint8_t level, color_mode;
+    uint16_t mireds;
+
+    if ( SL_STATUS_OK != _get_level( EP_RGB_LIGHT, &level ) ) return SL_STATUS_FAIL;
+    if ( SL_STATUS_OK != _get_color_temp( &color_mode, &mireds ) ) return SL_STATUS_FAIL;
+
+    if ( LLIGHT_COLOR_MODE_HSV == color_mode ) {
+        uint16_t hue;
+        uint8_t saturation;
+        if ( SL_STATUS_OK != _get_color_hsv( &hue, &saturation ) ) return SL_STATUS_FAIL;
+        // a running color loop is ahead of EnhancedCurrentHue, which it writes now and then only
+        (void) color_loop_hue( &hue );
+        _render_hsv_level( hue, saturation, level, red, green, blue );
+        return SL_STATUS_OK;
+    }
 
-    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
-            EP_RGB_LIGHT, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_CURRENT_X_ATTRIBUTE_ID,
-            (uint8_t *) &color_x, sizeof(color_x)
-    )) return SL_STATUS_FAIL;
-    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
-            EP_RGB_LIGHT, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_CURRENT_Y_ATTRIBUTE_ID,
-            (uint8_t *) &color_y, sizeof(color_y)
-    )) return SL_STATUS_FAIL;
-    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
-            EP_RGB_LIGHT, ZCL_LEVEL_CONTROL_CLUSTER_ID, ZCL_CURRENT_LEVEL_ATTRIBUTE_ID,
-            &level, sizeof(level)
-    )) return SL_STATUS_FAIL;
+    if ( SL_STATUS_OK != _get_chromaticity( &color_x, &color_y ) ) return SL_STATUS_FAIL;
 
-    sl_zigbee_app_debug_println("Current x,y is (0x%x, 0x%x), level: %d (int)", color_x, color_y, level);
-
-    float x = color_x / 65535.0f;
-    float y = color_y / 65535.0f;
-    float z = 1.0f - x - y;
-
-    float Y = ( 1.0f * level) / 255.0f ; // The reference white point luminance
-    sl_zigbee_app_debug_println("Current x,y is (%.5f, %.5f), luminance: %f (float)", x, y, Y);
-    float X = (Y / y) * x;
-    float Z = (Y / y) * z;
-
-    float r_linear = X * 1.656492f - Y * 0.354851f - Z * 0.255038f;
-    float g_linear = -X * 0.707196f + Y * 1.655397f + Z * 0.036152f;
-    float b_linear = X * 0.051713f - Y * 0.121364f + Z * 1.011530f;
-    // Convert to linear RGB
-    // r_linear = X * 3.2406f - Y * 1.5372f - Z * 0.4986f;
-    // g_linear = -X * 0.9689f + Y * 1.8758f + Z * 0.0415f;
-    // b_linear = X * 0.0557f - Y * 0.2040f + Z * 1.0570f;
-
-
-    // Apply gamma correction to convert from linear to sRGB color space
-    float gamma = 2.4f;
-    float a = 0.055f;
-    float r = (r_linear <= 0.0031308f) ? 12.92f*r_linear : (1.0f+a)*pow(r_linear, 1.0/gamma) - a;
-    float g = (g_linear <= 0.0031308f) ? 12.92f*g_linear : (1.0f+a)*pow(g_linear, 1.0/gamma) - a;
-    float b = (b_linear <= 0.0031308f) ? 12.92f*b_linear : (1.0f+a)*pow(b_linear, 1.0/gamma) - a;
-
-    if (r < 0) {
-        r = 0;
-    } else if (r > 1) {
-        r = 1;
-    }
-    if (g < 0) {
-        g = 0;
-    } else if (g > 1) {
-        g = 1;
-    }
-    if (b < 0) {
-        b = 0;
-    } else if (b > 1) {
-        b = 1;
-    }
-
-    *red = (uint8_t) round( 255.0f * r * Y );
-    *green = (uint8_t) round( 255.0f * g * Y );
-    *blue = (uint8_t) round( 255.0f * b * Y );
-    sl_zigbee_app_debug_println("Calculated RGB: %d/%d/%d)",
-        (uint8_t) *red, (uint8_t) *blue, (uint8_t) *blue);
+    _render_xy_level( color_x, color_y, level, red, green, blue );
     return SL_STATUS_OK;
 }
 
 /**
- * @brief calculate and update XY color & level on the Color light endpoint, based
- *        on rgb values (levels for EP 2, 3 and 4)
+ * @brief channel intensities of the color light at the chromaticity and level
  */
-sl_status_t _update_xy_color_from_rgb(uint8_t red, uint8_t green, uint8_t blue)
+static void _render_xy_level(uint16_t color_x, uint16_t color_y, uint8_t level,
+                             uint16_t *red, uint16_t *green, uint16_t *blue)
 {
-    // Normalize the RGB values
-    float r = red / 255.0f;
-    float g = green / 255.0f;
-    float b = blue / 255.0f;
+#if HW_LIGHT_DIMMING_CURVE == DIMMING_CURVE_LINEAR
+#if HW_LIGHT_MIX_POWER_OPTIMAL
+    _mix_power_optimal( &color_x, &color_y, level );
+#endif // HW_LIGHT_MIX_POWER_OPTIMAL
+    color_conv_xy_to_rgb( color_x, color_y, level, red, green, blue );
+#else
+    // render the chromaticity at full luminance and let the curve alone do the dimming,
+    // it scales all the channels alike so the cheapest chromaticity stays the cheapest
+#if HW_LIGHT_MIX_POWER_OPTIMAL
+    _mix_power_optimal( &color_x, &color_y, 0xFF );
+#endif // HW_LIGHT_MIX_POWER_OPTIMAL
+    color_conv_xy_to_rgb( color_x, color_y, 0xFF, red, green, blue );
+    *red = dimming_apply( *red, level );
+    *green = dimming_apply( *green, level );
+    *blue = dimming_apply( *blue, level );
+#endif // HW_LIGHT_DIMMING_CURVE
+}
 
-    // Apply gamma correction
-    r = (r > 0.04045f) ? powf((r + 0.055f) / 1.055f, 2.4f) : (r / 12.92f);
-    g = (g > 0.04045f) ? powf((g + 0.055f) / 1.055f, 2.4f) : (g / 12.92f);
-    b = (b > 0.04045f) ? powf((b + 0.055f) / 1.055f, 2.4f) : (b / 12.92f);
+/**
+ * @brief channel intensities of the color light at the hue, saturation and level
+ */
+static void _render_hsv_level(uint16_t hue, uint8_t saturation, uint8_t level,
+                              uint16_t *red, uint16_t *green, uint16_t *blue)
+{
+#if HW_LIGHT_DIMMING_CURVE == DIMMING_CURVE_LINEAR
+    color_conv_hsv_to_rgb( hue, saturation, level, red, green, blue );
+#else
+    color_conv_hsv_to_rgb( hue, saturation, 0xFF, red, green, blue );
+    *red = dimming_apply( *red, level );
+    *green = dimming_apply( *green, level );
+    *blue = dimming_apply( *blue, level );
+#endif // HW_LIGHT_DIMMING_CURVE
+}
 
-    // Convert to XYZ color space
-    float X = r * 0.4124f + g * 0.3576f + b * 0.1805f;
-    float Y = r * 0.2126f + g * 0.7152f + b * 0.0722f;
-    float Z = r * 0.0193f + g * 0.1192f + b * 0.9505f;
+#if HW_LIGHT_MIX_POWER_OPTIMAL
+/**
+ * @brief move the chromaticity within HW_LIGHT_MIX_XY_TOLERANCE to where the channels
+ *        reproduce it at the lowest current. The luminance is given by the level and
+ *        doesn't change, chromaticities the channels can't reproduce are not considered
+ * @param[in,out] color_x, color_y -- requested chromaticity in, chromaticity to render out
+ * @param[in] level -- luminance it is rendered at
+ */
+static void _mix_power_optimal(uint16_t *color_x, uint16_t *color_y, uint8_t level)
+{
+    // unit vectors in eight directions, Q8
+    static const int16_t directions[8][2] = {
+        {  256,    0 }, {  181,  181 }, {    0,  256 }, { -181,  181 },
+        { -256,    0 }, { -181, -181 }, {    0, -256 }, {  181, -181 },
+    };
+    uint16_t red, green, blue;
+
+    if ( !level ) return;
+    if ( !color_conv_xy_to_rgb_in_gamut( *color_x, *color_y, level, &red, &green, &blue ) ) return;
+
+    uint32_t lowest_ua = hw_light_estimate_current_ua( red, green, blue );
+    uint16_t best_x = *color_x;
+    uint16_t best_y = *color_y;
+    for ( uint8_t i = 0; i < sizeof(directions) / sizeof(directions[0]); i++ ) {
+        int32_t x = *color_x + ((directions[i][0] * HW_LIGHT_MIX_XY_TOLERANCE) >> 8);
+        int32_t y = *color_y + ((directions[i][1] * HW_LIGHT_MIX_XY_TOLERANCE) >> 8);
+        if ( x < 0 || y <= 0 || x > LLIGHT_MAX_CIE_XY || y > LLIGHT_MAX_CIE_XY ) continue;
+        if ( !color_conv_xy_to_rgb_in_gamut( (uint16_t) x, (uint16_t) y, level, &red, &green, &blue ) ) continue;
+
+        uint32_t current_ua = hw_light_estimate_current_ua( red, green, blue );
+        if ( current_ua < lowest_ua ) {
+            lowest_ua = current_ua;
+            best_x = (uint16_t) x;
+            best_y = (uint16_t) y;
+        }
+    }
+    *color_x = best_x;
+    *color_y = best_y;
+}
+#endif // HW_LIGHT_MIX_POWER_OPTIMAL
 
-    // Convert to xy color space
-    float x = X / (X + Y + Z);
-    float y = Y / (X + Y + Z);
+/**
+ * @brief calculate and update XY color & level on the Color light endpoint, based
+ *        on rgb values (levels for EP 2, 3 and 4)
+ */
+sl_status_t _update_xy_color_from_rgb(uint8_t red, uint8_t green, uint8_t blue)
+{
+    uint8_t brightness = 0;
+    uint16_t color_x, color_y;
+    uint8_t color_mode = LLIGHT_COLOR_MODE_XY;
 
-    // Calculate brightness
-    uint8_t brightness = round(Y * 255.0f );
-    uint16_t color_x = round( x * 65535.0f );
-    uint16_t color_y = round( y * 65535.0f );
+    bool has_color = color_conv_rgb_to_xy( red, green, blue, &color_x, &color_y, &brightness );
 
     emberAfWriteServerAttribute(
         EP_RGB_LIGHT,
@@ -538,6 +1067,9 @@ sl_status_t _update_xy_color_from_rgb(uint8_t red, uint8_t green, uint8_t blue)
         &brightness,
         ZCL_INT8U_ATTRIBUTE_TYPE
     );
+    // all channels are off, keep the last chromaticity
+    if ( !has_color ) return SL_STATUS_OK;
+
     emberAfWriteServerAttribute(
         EP_RGB_LIGHT,
         ZCL_COLOR_CONTROL_CLUSTER_ID,
@@ -552,11 +1084,378 @@ sl_status_t _update_xy_color_from_rgb(uint8_t red, uint8_t green, uint8_t blue)
         (uint8_t *) &color_y,
         ZCL_INT16U_ATTRIBUTE_TYPE
     );
-
-    sl_zigbee_app_debug_println("Updated RGB EP color_x: %d, color_y: %d, level: %d from RGB %d/%d/%d",
-        color_x, color_y, brightness,
-        red, green, blue
+    // the channels define an xy color now, whatever the color light was set with before
+    emberAfWriteServerAttribute(
+        EP_RGB_LIGHT,
+        ZCL_COLOR_CONTROL_CLUSTER_ID,
+        ZCL_COLOR_CONTROL_COLOR_MODE_ATTRIBUTE_ID,
+        &color_mode,
+        ZCL_ENUM8_ATTRIBUTE_TYPE
     );
+    emberAfWriteServerAttribute(
+        EP_RGB_LIGHT,
+        ZCL_COLOR_CONTROL_CLUSTER_ID,
+        ZCL_COLOR_CONTROL_ENHANCED_COLOR_MODE_ATTRIBUTE_ID,
+        &color_mode,
+        ZCL_ENUM8_ATTRIBUTE_TYPE
+    );
+
+    return SL_STATUS_OK;
+}
+
+/**
+ * @brief fill the light state shadow from the attribute table, once all the clusters
+ *        are initialized. Later changes come through llight_attribute_changed()
+ */
+static sl_status_t _shadow_load(void)
+{
+    _state.shadow.valid = false;
+
+    for ( uint8_t ep = EP_RGB_LIGHT; ep <= EP_BLUE_CHANNEL; ep++ ) {
+        _ep_shadow_t *shadow = &_state.shadow.ep[ep - EP_RGB_LIGHT];
+        if ( SL_STATUS_OK != _get_onoff( ep, &shadow->on_off ) ) return SL_STATUS_FAIL;
+        if ( SL_STATUS_OK != _get_level( ep, &shadow->level ) ) return SL_STATUS_FAIL;
+    }
+    if ( SL_STATUS_OK != _get_color_xy( &_state.shadow.color_x, &_state.shadow.color_y ) ) {
+        return SL_STATUS_FAIL;
+    }
+    if ( SL_STATUS_OK != _get_color_temp( &_state.shadow.color_mode, &_state.shadow.color_temp_mireds ) ) {
+        return SL_STATUS_FAIL;
+    }
+    if ( SL_STATUS_OK != _read_hsv_attributes( &_state.shadow.hsv ) ) return SL_STATUS_FAIL;
+
+    _state.shadow.valid = true;
+    return SL_STATUS_OK;
+}
+
+/**
+ * @brief shadow of a light endpoint
+ * @return NULL if the endpoint is not a light endpoint or the shadow is not loaded yet
+ */
+static _ep_shadow_t *_shadow_ep(uint8_t endpoint)
+{
+    if ( !_state.shadow.valid || (endpoint < EP_RGB_LIGHT) || (endpoint > EP_BLUE_CHANNEL) ) {
+        return NULL;
+    }
+    return &_state.shadow.ep[endpoint - EP_RGB_LIGHT];
+}
 
+/**
+ * @brief get on_off of an endpoint from the shadow, or the attribute table
+ */
+static sl_status_t _get_onoff(uint8_t endpoint, uint8_t *on_off)
+{
+    _ep_shadow_t *shadow = _shadow_ep( endpoint );
+    if ( shadow ) {
+        *on_off = shadow->on_off;
+        return SL_STATUS_OK;
+    }
+
+    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
+            endpoint, ZCL_ON_OFF_CLUSTER_ID, ZCL_ON_OFF_ATTRIBUTE_ID,
+            on_off, sizeof(*on_off)
+    )) return SL_STATUS_FAIL;
     return SL_STATUS_OK;
 }
+
+/**
+ * @brief get current level of an endpoint from the shadow, or the attribute table
+ */
+static sl_status_t _get_level(uint8_t endpoint, uint8_t *level)
+{
+    _ep_shadow_t *shadow = _shadow_ep( endpoint );
+    if ( shadow ) {
+        *level = shadow->level;
+        return SL_STATUS_OK;
+    }
+
+    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
+            endpoint, ZCL_LEVEL_CONTROL_CLUSTER_ID, ZCL_CURRENT_LEVEL_ATTRIBUTE_ID,
+            level, sizeof(*level)
+    )) return SL_STATUS_FAIL;
+    return SL_STATUS_OK;
+}
+
+/**
+ * @brief get current x & y of the color light from the shadow, or the attribute table
+ */
+static sl_status_t _get_color_xy(uint16_t *color_x, uint16_t *color_y)
+{
+    if ( _state.shadow.valid ) {
+        *color_x = _state.shadow.color_x;
+        *color_y = _state.shadow.color_y;
+        return SL_STATUS_OK;
+    }
+
+    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
+            EP_RGB_LIGHT, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_CURRENT_X_ATTRIBUTE_ID,
+            (uint8_t *) color_x, sizeof(*color_x)
+    )) return SL_STATUS_FAIL;
+    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
+            EP_RGB_LIGHT, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_CURRENT_Y_ATTRIBUTE_ID,
+            (uint8_t *) color_y, sizeof(*color_y)
+    )) return SL_STATUS_FAIL;
+    return SL_STATUS_OK;
+}
+
+/**
+ * @brief get ColorMode and the color temperature of the color light from the shadow,
+ *        or the attribute table
+ */
+static sl_status_t _get_color_temp(uint8_t *color_mode, uint16_t *mireds)
+{
+    if ( _state.shadow.valid ) {
+        *color_mode = _state.shadow.color_mode;
+        *mireds = _state.shadow.color_temp_mireds;
+        return SL_STATUS_OK;
+    }
+
+    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
+            EP_RGB_LIGHT, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_COLOR_MODE_ATTRIBUTE_ID,
+            color_mode, sizeof(*color_mode)
+    )) return SL_STATUS_FAIL;
+    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
+            EP_RGB_LIGHT, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_COLOR_TEMPERATURE_ATTRIBUTE_ID,
+            (uint8_t *) mireds, sizeof(*mireds)
+    )) return SL_STATUS_FAIL;
+    return SL_STATUS_OK;
+}
+
+/**
+ * @brief chromaticity the color light renders, CurrentX / CurrentY or the point of the
+ *        color temperature on the Planckian locus, depending on ColorMode
+ */
+static sl_status_t _get_chromaticity(uint16_t *color_x, uint16_t *color_y)
+{
+    uint8_t color_mode;
+    uint16_t mireds;
+
+    if ( SL_STATUS_OK != _get_color_temp( &color_mode, &mireds ) ) return SL_STATUS_FAIL;
+    if ( LLIGHT_COLOR_MODE_TEMPERATURE == color_mode ) {
+        color_conv_mireds_to_xy( mireds, color_x, color_y );
+        return SL_STATUS_OK;
+    }
+    return _get_color_xy( color_x, color_y );
+}
+
+/**
+ * @brief read the hue and saturation attributes of the color light
+ */
+static sl_status_t _read_hsv_attributes(_hsv_attributes_t *hsv)
+{
+    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
+            EP_RGB_LIGHT, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_CURRENT_HUE_ATTRIBUTE_ID,
+            &hsv->current_hue, sizeof(hsv->current_hue)
+    )) return SL_STATUS_FAIL;
+    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
+            EP_RGB_LIGHT, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_ENHANCED_CURRENT_HUE_ATTRIBUTE_ID,
+            (uint8_t *) &hsv->enhanced_hue, sizeof(hsv->enhanced_hue)
+    )) return SL_STATUS_FAIL;
+    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
+            EP_RGB_LIGHT, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_CURRENT_SATURATION_ATTRIBUTE_ID,
+            &hsv->saturation, sizeof(hsv->saturation)
+    )) return SL_STATUS_FAIL;
+    if ( EMBER_ZCL_STATUS_SUCCESS != emberAfReadServerAttribute(
+            EP_RGB_LIGHT, ZCL_COLOR_CONTROL_CLUSTER_ID, ZCL_COLOR_CONTROL_ENHANCED_COLOR_MODE_ATTRIBUTE_ID,
+            &hsv->enhanced_color_mode, sizeof(hsv->enhanced_color_mode)
+    )) return SL_STATUS_FAIL;
+    return SL_STATUS_OK;
+}
+
+/**
+ * @brief get hue and saturation of the color light from the shadow, or the attribute table
+ * @param[out] hue -- EnhancedCurrentHue, or CurrentHue scaled to it, 0x10000 == 360 degrees
+ * @param[out] saturation -- CurrentSaturation
+ */
+static sl_status_t _get_color_hsv(uint16_t *hue, uint8_t *saturation)
+{
+    _hsv_attributes_t attributes;
+    const _hsv_attributes_t *hsv = &_state.shadow.hsv;
+
+    if ( !_state.shadow.valid ) {
+        if ( SL_STATUS_OK != _read_hsv_attributes( &attributes ) ) return SL_STATUS_FAIL;
+        hsv = &attributes;
+    }
+
+    *saturation = hsv->saturation;
+    if ( LLIGHT_ENHANCED_COLOR_MODE_ENHANCED_HUE == hsv->enhanced_color_mode ) {
+        *hue = hsv->enhanced_hue;
+    } else {
+        // CurrentHue 254 is 360 degrees again, it wraps to 0
+        *hue = (uint16_t) (((uint32_t) hsv->current_hue << 16) / LLIGHT_HUE_STEPS);
+    }
+    return SL_STATUS_OK;
+}
+
+/**
+ * @brief RGB channel driven by a channel endpoint
+ * @return false if the endpoint is not a channel endpoint
+ */
+static bool _endpoint_to_channel(uint8_t endpoint, enum RGB_channel_name_t *ch_name)
+{
+    for ( uint8_t i = 0; i < CHANNEL_ENDPOINT_COUNT; i++ ) {
+        if ( _channel_endpoints[i].endpoint != endpoint ) continue;
+        *ch_name = _channel_endpoints[i].ch_name;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief CurrentX / CurrentY after a step, clamped the same way the color server does
+ */
+static uint16_t _step_xy(uint16_t value, int16_t step)
+{
+    int32_t stepped = (int32_t) value + step;
+    if ( stepped < 0 ) return 0;
+    if ( stepped > LLIGHT_MAX_CIE_XY ) return LLIGHT_MAX_CIE_XY;
+    return (uint16_t) stepped;
+}
+
+/**
+ * @brief value of a motion at a point in time, the target once it is over
+ */
+static uint16_t _motion_at(const _motion_t *motion, uint32_t time_ms)
+{
+    uint32_t elapsed = time_ms - motion->start_ms;
+    if ( elapsed >= motion->duration_ms ) return motion->to;
+    int32_t delta = (int32_t) motion->to - (int32_t) motion->from;
+    return (uint16_t) ( motion->from + (int32_t) ( ((int64_t) delta * elapsed) / motion->duration_ms ) );
+}
+
+/**
+ * @brief true if the value lies on the path of the motion
+ */
+static bool _motion_covers(const _motion_t *motion, uint16_t value)
+{
+    uint16_t low = motion->from < motion->to ? motion->from : motion->to;
+    uint16_t high = motion->from < motion->to ? motion->to : motion->from;
+    return (value >= low) && (value <= high);
+}
+
+/**
+ * @brief start a move of one color light attribute. The other attributes keep their motion,
+ *        or hold their current value if no keyframes are running
+ * @param[in] motion -- motion of the attribute in the keyframes state
+ * @param[in] current -- current value of the attribute
+ * @param[in] target -- value at the end of the transition
+ * @param[in] transition_ms -- transition time
+ */
+static void _keyframes_move(_motion_t *motion, uint16_t current, uint16_t target, uint32_t transition_ms)
+{
+    _keyframes_t *kf = &_state.keyframes;
+    uint32_t now = TIMESTAMP_MS;
+
+    if ( !kf->valid ) {
+        kf->color_x = (_motion_t) { _state.shadow.color_x, _state.shadow.color_x, now, 0 };
+        kf->color_y = (_motion_t) { _state.shadow.color_y, _state.shadow.color_y, now, 0 };
+        kf->mireds = (_motion_t) { _state.shadow.color_temp_mireds, _state.shadow.color_temp_mireds, now, 0 };
+        kf->level = (_motion_t) { _state.shadow.ep[0].level, _state.shadow.ep[0].level, now, 0 };
+        kf->color_mode = _state.shadow.color_mode;
+    }
+    *motion = (_motion_t) { current, target, now, transition_ms };
+}
+
+/**
+ * @brief render the keyframes from now until the last running motion ends
+ */
+static void _keyframes_build(void)
+{
+    _keyframes_t *kf = &_state.keyframes;
+    const _motion_t *motions[] = { &kf->color_x, &kf->color_y, &kf->mireds, &kf->level };
+    uint32_t now = TIMESTAMP_MS;
+    uint32_t span_ms = 0;
+
+    kf->valid = false;
+    // a hue sweep renders every frame directly, it is cheaper than interpolating keyframes
+    if ( LLIGHT_COLOR_MODE_HSV == kf->color_mode ) return;
+    for ( uint8_t i = 0; i < sizeof(motions) / sizeof(motions[0]); i++ ) {
+        int32_t remaining = (int32_t) (motions[i]->start_ms + motions[i]->duration_ms - now);
+        if ( remaining > (int32_t) span_ms ) span_ms = (uint32_t) remaining;
+    }
+    if ( 0 == span_ms ) return;
+
+    for ( uint8_t i = 0; i < LLIGHT_KEYFRAMES; i++ ) {
+        uint32_t time_ms = now + (uint32_t) ( ((uint64_t) span_ms * i) / (LLIGHT_KEYFRAMES - 1) );
+        uint16_t color_x, color_y;
+        // color temperature moves linearly in mireds, the keyframes follow the locus
+        if ( LLIGHT_COLOR_MODE_TEMPERATURE == kf->color_mode ) {
+            color_conv_mireds_to_xy( _motion_at( &kf->mireds, time_ms ), &color_x, &color_y );
+        } else {
+            color_x = _motion_at( &kf->color_x, time_ms );
+            color_y = _motion_at( &kf->color_y, time_ms );
+        }
+        _render_xy_level( color_x, color_y, (uint8_t) _motion_at( &kf->level, time_ms ),
+                          &kf->frames[i][0], &kf->frames[i][1], &kf->frames[i][2] );
+    }
+    kf->start_ms = now;
+    kf->span_ms = span_ms;
+    kf->valid = true;
+}
+
+/**
+ * @brief channel intensities of the color light, interpolated from the keyframes
+ * @return false if there are no keyframes for the current state, render it directly
+ */
+static bool _keyframes_render(uint16_t *red, uint16_t *green, uint16_t *blue)
+{
+    _keyframes_t *kf = &_state.keyframes;
+    uint16_t *out[] = { red, green, blue };
+    bool chromaticity_at_end, chromaticity_on_path;
+
+    if ( !kf->valid ) return false;
+
+    if ( LLIGHT_COLOR_MODE_TEMPERATURE == kf->color_mode ) {
+        chromaticity_at_end = (_state.shadow.color_temp_mireds == kf->mireds.to);
+        chromaticity_on_path = _motion_covers( &kf->mireds, _state.shadow.color_temp_mireds );
+    } else {
+        chromaticity_at_end = (_state.shadow.color_x == kf->color_x.to)
+                              && (_state.shadow.color_y == kf->color_y.to);
+        chromaticity_on_path = _motion_covers( &kf->color_x, _state.shadow.color_x )
+                               && _motion_covers( &kf->color_y, _state.shadow.color_y );
+    }
+    chromaticity_on_path &= (kf->color_mode == _state.shadow.color_mode);
+
+    uint32_t elapsed = TIMESTAMP_MS - kf->start_ms;
+    // the end state is rendered exactly, and any command the table doesn't know about
+    // moves the attributes off the path of the motions
+    if ( (elapsed >= kf->span_ms)
+         || ( chromaticity_at_end && (_state.shadow.ep[0].level == kf->level.to) )
+         || !chromaticity_on_path
+         || !_motion_covers( &kf->level, _state.shadow.ep[0].level ) ) {
+        kf->valid = false;
+        return false;
+    }
+
+    uint32_t position = elapsed * (LLIGHT_KEYFRAMES - 1);
+    uint32_t index = position / kf->span_ms;
+    uint32_t fraction = position % kf->span_ms;
+    for ( uint8_t c = 0; c < 3; c++ ) {
+        int32_t delta = (int32_t) kf->frames[index + 1][c] - (int32_t) kf->frames[index][c];
+        *out[c] = (uint16_t) ( kf->frames[index][c] + (int32_t) ( ((int64_t) delta * fraction) / kf->span_ms ) );
+    }
+    return true;
+}
+
+#if defined(SL_CATALOG_ZIGBEE_SCENES_PRESENT) && defined(ZCL_USING_COLOR_CONTROL_CLUSTER_SERVER)
+/**
+ * @brief stored xy and transition time of a scene on the color light
+ * @return false if the scene is not stored or does not carry a color
+ */
+static bool _scene_color_xy(uint16_t group_id, uint8_t scene_id,
+                            uint16_t *color_x, uint16_t *color_y, uint32_t *transition_ms)
+{
+    EmberAfSceneTableEntry entry;
+
+    for ( uint8_t i = 0; i < EMBER_AF_PLUGIN_SCENES_TABLE_SIZE; i++ ) {
+        emberAfPluginScenesServerRetrieveSceneEntry( entry, i );
+        if ( (EP_RGB_LIGHT != entry.endpoint) || (group_id != entry.groupId) || (scene_id != entry.sceneId) ) continue;
+        if ( !entry.hasCurrentXValue || !entry.hasCurrentYValue ) return false;
+        *color_x = entry.currentXValue;
+        *color_y = entry.currentYValue;
+        *transition_ms = entry.transitionTime * 1000UL + entry.transitionTime100ms * 100UL;
+        return true;
+    }
+    return false;
+}
+#endif // SL_CATALOG_ZIGBEE_SCENES_PRESENT && ZCL_USING_COLOR_CONTROL_CLUSTER_SERVER
@@ -3,11 +3,23 @@
 
 #include "af.h"
 
+void llight_init(void);
+void llight_tick(void);
 void llight_disable_external_updates(void);
 void llight_enable_external_updates(void);
+void llight_attribute_changed(uint8_t endpoint,
+                              EmberAfClusterId clusterId,
+                              EmberAfAttributeId attributeId,
+                              uint8_t *value);
+sl_status_t llight_get_onoff(uint8_t endpoint, uint8_t *on_off);
 sl_status_t llight_turnon_light(uint8_t endpoint);
 sl_status_t llight_turnoff_light(uint8_t endpoint);
 sl_status_t llight_turnonoff_light(uint8_t endpoint, bool turnOn);
 sl_status_t llight_set_level(uint8_t endpoint, uint8_t level);
+bool llight_fade_start(uint8_t endpoint, uint8_t level, uint32_t transition_ms);
+void llight_fade_end(uint8_t endpoint);
+void llight_fade_cancel(uint8_t endpoint);
+void llight_command_received(const EmberAfClusterCommand *cmd);
+void llight_render_color(bool publish_channels);
 
 #endif // _LOGICAL_LIGHT_H_
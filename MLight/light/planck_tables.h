@@ -0,0 +1,27 @@
+// Generated by tools/gen_light_tables.py, do not edit.
+#ifndef _PLANCK_TABLES_H_
+#define _PLANCK_TABLES_H_
+
+#include <stdint.h>
+
+#define PLANCK_MIREDS_MIN 40
+#define PLANCK_MIREDS_MAX 600
+#define PLANCK_STEP_SHIFT 4
+
+// Planckian locus CIE x and y at PLANCK_MIREDS_MIN + i * 2^PLANCK_STEP_SHIFT mireds,
+// as ZCL CurrentX / CurrentY (x * 65535)
+static const uint16_t planck_locus_x[36] = {
+    16546, 16969, 17446, 17972, 18542, 19151, 19793, 20466, 21162, 21878,
+    22609, 23350, 24095, 24840, 25584, 26309, 27018, 27712, 28389, 29050,
+    29693, 30319, 30928, 31517, 32088, 32640, 33172, 33684, 34176, 34646,
+    35095, 35523, 35928, 36311, 36670, 37006,
+};
+
+static const uint16_t planck_locus_y[36] = {
+    16532, 17104, 17726, 18384, 19066, 19759, 20451, 21134, 21797, 22435,
+    23041, 23611, 24140, 24628, 25081, 25483, 25837, 26145, 26409, 26631,
+    26814, 26960, 27070, 27148, 27195, 27215, 27209, 27182, 27133, 27065,
+    26980, 26881, 26772, 26653, 26530, 26402,
+};
+
+#endif // _PLANCK_TABLES_H_
@@ -0,0 +1,211 @@
+#include "af.h"
+#ifdef SL_COMPONENT_CATALOG_PRESENT
+#include "sl_component_catalog.h"
+#endif // SL_COMPONENT_CATALOG_PRESENT
+#include "sl_zigbee_debug_print.h"
+#ifdef SL_CATALOG_CLI_PRESENT
+#include "sl_cli.h"
+#define TRANSITION_STATS_CLI_IDX_ENDPOINT 0
+#endif // SL_CATALOG_CLI_PRESENT
+
+#include "transition_stats.h"
+
+#ifndef MIN
+#define MIN(a, b) ( (a) < (b) ? (a) : (b) )
+#endif // MIN
+#define SATURATING_INC(v, max) do { if ( (v) < (max) ) (v)++; } while (0)
+
+typedef struct {
+    transition_stats_t stats;
+    // current transition
+    bool first_tick_seen;
+    uint32_t first_tick_lag_ms;
+    uint32_t max_lateness_ms;
+} _endpoint_stats_t;
+
+static _endpoint_stats_t _stats[EMBER_AF_LEVEL_CONTROL_CLUSTER_SERVER_ENDPOINT_COUNT];
+
+static const uint16_t _histogram_bounds_ms[TRANSITION_STATS_HISTOGRAM_BUCKETS - 1] = {
+    2, 5, 10, 20, 50, 100, 200
+};
+
+static _endpoint_stats_t *_get_stats(uint8_t endpoint);
+static void _update_attributes(uint8_t endpoint, const transition_stats_t *stats);
+
+/**
+ * @brief a new transition was scheduled on the endpoint, drops the per transition
+ *        state of an interrupted one
+ */
+void transition_stats_start(uint8_t endpoint)
+{
+    _endpoint_stats_t *ep_stats = _get_stats( endpoint );
+    if ( NULL == ep_stats ) return;
+
+    ep_stats->first_tick_seen = false;
+    ep_stats->first_tick_lag_ms = 0;
+    ep_stats->max_lateness_ms = 0;
+}
+
+/**
+ * @brief a transition tick ran
+ * @param[in] lateness_ms -- how late the tick ran against its scheduled time
+ */
+void transition_stats_record_tick(uint8_t endpoint, uint32_t lateness_ms)
+{
+    _endpoint_stats_t *ep_stats = _get_stats( endpoint );
+    if ( NULL == ep_stats ) return;
+
+    if ( !ep_stats->first_tick_seen ) {
+        ep_stats->first_tick_seen = true;
+        ep_stats->first_tick_lag_ms = lateness_ms;
+    }
+    if ( lateness_ms > ep_stats->max_lateness_ms ) ep_stats->max_lateness_ms = lateness_ms;
+}
+
+/**
+ * @brief a transition reached its target level
+ * @param[in] requested_ms -- transition time the command asked for
+ * @param[in] actual_ms -- time from scheduling the transition until the final level
+ */
+void transition_stats_record_transition(uint8_t endpoint, uint32_t requested_ms, uint32_t actual_ms)
+{
+    _endpoint_stats_t *ep_stats = _get_stats( endpoint );
+    if ( NULL == ep_stats ) return;
+    transition_stats_t *stats = &ep_stats->stats;
+
+    uint32_t error_ms = actual_ms > requested_ms ? actual_ms - requested_ms : requested_ms - actual_ms;
+    uint8_t bucket = 0;
+    while ( (bucket < (TRANSITION_STATS_HISTOGRAM_BUCKETS - 1))
+            && (ep_stats->max_lateness_ms >= _histogram_bounds_ms[bucket]) ) {
+        bucket++;
+    }
+
+    SATURATING_INC( stats->transitions, UINT32_MAX );
+    stats->sum_abs_duration_error_ms += error_ms;
+    if ( error_ms > stats->max_abs_duration_error_ms ) stats->max_abs_duration_error_ms = error_ms;
+    stats->sum_first_tick_lag_ms += ep_stats->first_tick_lag_ms;
+    if ( ep_stats->first_tick_lag_ms > stats->max_first_tick_lag_ms ) {
+        stats->max_first_tick_lag_ms = ep_stats->first_tick_lag_ms;
+    }
+    SATURATING_INC( stats->lateness_histogram[bucket], UINT16_MAX );
+
+    _update_attributes( endpoint, stats );
+    transition_stats_start( endpoint );
+}
+
+/**
+ * @brief get the accumulated statistics of the endpoint
+ * @return NULL if the endpoint has no level control server
+ */
+const transition_stats_t *transition_stats_get(uint8_t endpoint)
+{
+    _endpoint_stats_t *ep_stats = _get_stats( endpoint );
+    return ep_stats ? &ep_stats->stats : NULL;
+}
+
+/**
+ * @brief clear the statistics of the endpoint
+ */
+void transition_stats_reset(uint8_t endpoint)
+{
+    _endpoint_stats_t *ep_stats = _get_stats( endpoint );
+    if ( NULL == ep_stats ) return;
+
+    MEMSET( &ep_stats->stats, 0, sizeof(ep_stats->stats) );
+    _update_attributes( endpoint, &ep_stats->stats );
+}
+
+// *****************************
+// internal method implementations
+// -----------------------------
+static _endpoint_stats_t *_get_stats(uint8_t endpoint)
+{
+    uint8_t idx = emberAfFindClusterServerEndpointIndex( endpoint, ZCL_LEVEL_CONTROL_CLUSTER_ID );
+    return ( 0xFF == idx ) ? NULL : &_stats[idx];
+}
+
+/**
+ * @brief publish the statistics in the manufacturer specific Level Control attributes,
+ *        endpoints without the attributes just fail the writes
+ */
+static void _update_attributes(uint8_t endpoint, const transition_stats_t *stats)
+{
+    uint16_t avg_error_ms = 0, max_error_ms, avg_lag_ms = 0;
+    // octet string: length byte followed by little endian uint16 bucket counters
+    uint8_t histogram[1 + sizeof(stats->lateness_histogram)];
+
+    if ( stats->transitions ) {
+        avg_error_ms = (uint16_t) MIN( stats->sum_abs_duration_error_ms / stats->transitions, UINT16_MAX );
+        avg_lag_ms = (uint16_t) MIN( stats->sum_first_tick_lag_ms / stats->transitions, UINT16_MAX );
+    }
+    max_error_ms = (uint16_t) MIN( stats->max_abs_duration_error_ms, UINT16_MAX );
+
+    histogram[0] = sizeof(stats->lateness_histogram);
+    for ( uint8_t i = 0; i < TRANSITION_STATS_HISTOGRAM_BUCKETS; i++ ) {
+        histogram[1 + 2 * i] = LOW_BYTE( stats->lateness_histogram[i] );
+        histogram[2 + 2 * i] = HIGH_BYTE( stats->lateness_histogram[i] );
+    }
+
+    emberAfWriteManufacturerSpecificServerAttribute(
+        endpoint, ZCL_LEVEL_CONTROL_CLUSTER_ID, TRANSITION_STATS_COUNT_ATTRIBUTE_ID,
+        TRANSITION_STATS_MFG_CODE, (uint8_t *) &stats->transitions, ZCL_INT32U_ATTRIBUTE_TYPE );
+    emberAfWriteManufacturerSpecificServerAttribute(
+        endpoint, ZCL_LEVEL_CONTROL_CLUSTER_ID, TRANSITION_STATS_AVG_DURATION_ERROR_ATTRIBUTE_ID,
+        TRANSITION_STATS_MFG_CODE, (uint8_t *) &avg_error_ms, ZCL_INT16U_ATTRIBUTE_TYPE );
+    emberAfWriteManufacturerSpecificServerAttribute(
+        endpoint, ZCL_LEVEL_CONTROL_CLUSTER_ID, TRANSITION_STATS_MAX_DURATION_ERROR_ATTRIBUTE_ID,
+        TRANSITION_STATS_MFG_CODE, (uint8_t *) &max_error_ms, ZCL_INT16U_ATTRIBUTE_TYPE );
+    emberAfWriteManufacturerSpecificServerAttribute(
+        endpoint, ZCL_LEVEL_CONTROL_CLUSTER_ID, TRANSITION_STATS_AVG_FIRST_TICK_LAG_ATTRIBUTE_ID,
+        TRANSITION_STATS_MFG_CODE, (uint8_t *) &avg_lag_ms, ZCL_INT16U_ATTRIBUTE_TYPE );
+    emberAfWriteManufacturerSpecificServerAttribute(
+        endpoint, ZCL_LEVEL_CONTROL_CLUSTER_ID, TRANSITION_STATS_LATENESS_HISTOGRAM_ATTRIBUTE_ID,
+        TRANSITION_STATS_MFG_CODE, histogram, ZCL_OCTET_STRING_ATTRIBUTE_TYPE );
+}
+
+// -----------------------------------------------------------------------------
+// CLI related functions
+
+#ifdef SL_CATALOG_CLI_PRESENT
+/***************************************************************************//**
+ * Command Line Interface callback, prints the transition statistics of an endpoint
+ *
+ * @param[in] arguments command line argument list
+ ******************************************************************************/
+void transition_stats_print_from_cli(sl_cli_command_arg_t *arguments)
+{
+    uint8_t endpoint = sl_cli_get_argument_uint8( arguments, TRANSITION_STATS_CLI_IDX_ENDPOINT );
+    const transition_stats_t *stats = transition_stats_get( endpoint );
+
+    if ( NULL == stats ) {
+        sl_zigbee_app_debug_println("No level control server on endpoint %d", endpoint);
+        return;
+    }
+
+    uint32_t n = stats->transitions ? stats->transitions : 1;
+    sl_zigbee_app_debug_println("Endpoint %d: %d transitions", endpoint, stats->transitions);
+    sl_zigbee_app_debug_println("  duration error ms avg/max: %d/%d",
+        stats->sum_abs_duration_error_ms / n, stats->max_abs_duration_error_ms);
+    sl_zigbee_app_debug_println("  first tick lag ms avg/max: %d/%d",
+        stats->sum_first_tick_lag_ms / n, stats->max_first_tick_lag_ms);
+    sl_zigbee_app_debug_print("  max tick lateness histogram:");
+    for ( uint8_t i = 0; i < TRANSITION_STATS_HISTOGRAM_BUCKETS; i++ ) {
+        if ( i < (TRANSITION_STATS_HISTOGRAM_BUCKETS - 1) ) {
+            sl_zigbee_app_debug_print(" <%dms: %d", _histogram_bounds_ms[i], stats->lateness_histogram[i]);
+        } else {
+            sl_zigbee_app_debug_print(" more: %d", stats->lateness_histogram[i]);
+        }
+    }
+    sl_zigbee_app_debug_println("");
+}
+
+/***************************************************************************//**
+ * Command Line Interface callback, clears the transition statistics of an endpoint
+ *
+ * @param[in] arguments command line argument list
+ ******************************************************************************/
+void transition_stats_reset_from_cli(sl_cli_command_arg_t *arguments)
+{
+    transition_stats_reset( sl_cli_get_argument_uint8( arguments, TRANSITION_STATS_CLI_IDX_ENDPOINT ) );
+}
+#endif // SL_CATALOG_CLI_PRESENT
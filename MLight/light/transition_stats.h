@@ -0,0 +1,62 @@
+#ifndef _TRANSITION_STATS_H_
+#define _TRANSITION_STATS_H_
+
+#include <stdint.h>
+
+/**
+ * Per endpoint timing statistics of the level control transitions, fed by the
+ * level-control plugin tick. Readable with the "light_stats" CLI command and as
+ * manufacturer specific attributes of the Level Control cluster.
+ */
+
+// Manufacturer specific Level Control attributes, see config/zcl/mlight-manufacturer.xml
+#define TRANSITION_STATS_MFG_CODE                          0x1002
+#define TRANSITION_STATS_COUNT_ATTRIBUTE_ID                0xF000
+#define TRANSITION_STATS_AVG_DURATION_ERROR_ATTRIBUTE_ID   0xF001
+#define TRANSITION_STATS_MAX_DURATION_ERROR_ATTRIBUTE_ID   0xF002
+#define TRANSITION_STATS_AVG_FIRST_TICK_LAG_ATTRIBUTE_ID   0xF003
+#define TRANSITION_STATS_LATENESS_HISTOGRAM_ATTRIBUTE_ID   0xF004
+
+// Histogram of the max tick lateness of each transition, bucket upper bounds in ms
+#define TRANSITION_STATS_HISTOGRAM_BUCKETS 8
+
+typedef struct {
+    uint32_t transitions;
+    uint32_t sum_abs_duration_error_ms;
+    uint32_t max_abs_duration_error_ms;
+    uint32_t sum_first_tick_lag_ms;
+    uint32_t max_first_tick_lag_ms;
+    uint16_t lateness_histogram[TRANSITION_STATS_HISTOGRAM_BUCKETS];
+} transition_stats_t;
+
+/**
+ * @brief a new transition was scheduled on the endpoint, drops the per transition
+ *        state of an interrupted one
+ */
+void transition_stats_start(uint8_t endpoint);
+
+/**
+ * @brief a transition tick ran
+ * @param[in] lateness_ms -- how late the tick ran against its scheduled time
+ */
+void transition_stats_record_tick(uint8_t endpoint, uint32_t lateness_ms);
+
+/**
+ * @brief a transition reached its target level
+ * @param[in] requested_ms -- transition time the command asked for
+ * @param[in] actual_ms -- time from scheduling the transition until the final level
+ */
+void transition_stats_record_transition(uint8_t endpoint, uint32_t requested_ms, uint32_t actual_ms);
+
+/**
+ * @brief get the accumulated statistics of the endpoint
+ * @return NULL if the endpoint has no level control server
+ */
+const transition_stats_t *transition_stats_get(uint8_t endpoint);
+
+/**
+ * @brief clear the statistics of the endpoint
+ */
+void transition_stats_reset(uint8_t endpoint);
+
+#endif // _TRANSITION_STATS_H_
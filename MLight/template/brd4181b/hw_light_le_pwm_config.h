@@ -0,0 +1,63 @@
+/***************************************************************************//**
+ * @brief MLight low-energy PWM output configuration, BRD4181B radio board.
+ ******************************************************************************/
+
+#ifndef HW_LIGHT_LE_PWM_CONFIG_H
+#define HW_LIGHT_LE_PWM_CONFIG_H
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <h>Low-energy PWM
+
+// <q HW_LIGHT_LE_PWM_ENABLE> Drive dimmed channels from LETIMER0
+// <i> Default: 0
+// <i> LETIMER keeps running in EM2, so a dimmed light doesn't hold the device in EM1.
+// <i> LETIMER has a single compare for both outputs, channels are handed over only
+// <i> while all the dimmed channels share the same duty: a single dimmed channel or
+// <i> channels dimmed together, mixed colors almost never qualify.
+// <i> The BRD4181B LEDs are on ports C and D, which LETIMER can't drive in EM2.
+#define HW_LIGHT_LE_PWM_ENABLE   0
+
+// <o HW_LIGHT_LE_PWM_FREQUENCY> PWM frequency, Hz <1250-4096>
+// <i> Default: 1250
+// <i> At least HW_LIGHT_LE_PWM_MIN_FREQUENCY, below it the full depth modulation of
+// <i> a dimmed LED is visible flicker. The resolution is the LF clock divided by the
+// <i> frequency, only 26 steps at 1250 Hz.
+#define HW_LIGHT_LE_PWM_FREQUENCY   1250
+
+// <o HW_LIGHT_LE_PWM_MAX_ERROR_PERCENT> Largest brightness step of a hand over, % <1-50>
+// <i> Default: 3
+// <i> The LETIMER duty is quantized to 1 / (LF clock / frequency) of full scale, 1/26
+// <i> (3.8%) at 1250 Hz from the 32768 Hz LF clock. Channels are handed over only while
+// <i> their LETIMER duty is within this share of the TIMER duty, otherwise the light
+// <i> would step every time the device enters EM2 and wakes up. At 1250 Hz a channel
+// <i> at 5% is 23% off and stays on the TIMER.
+#define HW_LIGHT_LE_PWM_MAX_ERROR_PERCENT   3
+
+// <o HW_LIGHT_LE_PWM_LFCLK> LETIMER clock source
+// <cmuSelect_LFXO=> LFXO
+// <cmuSelect_LFRCO=> LFRCO
+// <i> Default: cmuSelect_LFXO
+#define HW_LIGHT_LE_PWM_LFCLK   cmuSelect_LFXO
+
+// <o HW_LIGHT_LE_PWM_OUT0_CHANNEL> Channel on LETIMER0 OUT0
+// <0=> Red
+// <1=> Green
+// <2=> Blue
+// <255=> None
+// <i> Default: 255
+#define HW_LIGHT_LE_PWM_OUT0_CHANNEL   255
+
+// <o HW_LIGHT_LE_PWM_OUT1_CHANNEL> Channel on LETIMER0 OUT1
+// <0=> Red
+// <1=> Green
+// <2=> Blue
+// <255=> None
+// <i> Default: 255
+#define HW_LIGHT_LE_PWM_OUT1_CHANNEL   255
+
+// </h>
+
+// <<< end of configuration section >>>
+
+#endif // HW_LIGHT_LE_PWM_CONFIG_H
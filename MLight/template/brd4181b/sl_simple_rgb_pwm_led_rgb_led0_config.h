@@ -45,7 +45,7 @@
 // <i> dimming resolution that takes the input values from 0 to 99,
 // <i> set this value to 100
 // <i> Default: 256
-#define SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION     256
+#define SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RESOLUTION     1024
 
 // <o SL_SIMPLE_RGB_PWM_LED_RGB_LED0_RED_POLARITY> Red LED Polarity
 // <SL_SIMPLE_RGB_PWM_LED_POLARITY_ACTIVE_LOW=> Active low
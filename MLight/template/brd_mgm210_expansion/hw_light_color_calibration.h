@@ -0,0 +1,37 @@
+// Generated by tools/gen_color_matrix.py from brd_mgm210_expansion/light_calibration.json, do not edit.
+#ifndef HW_LIGHT_COLOR_CALIBRATION_H
+#define HW_LIGHT_COLOR_CALIBRATION_H
+
+// XYZ -> linear RGB, Q16
+#define HW_LIGHT_XYZ_TO_RGB { \
+    {  212400, -100754,  -32677 }, \
+    {  -63506,  122915,    2723 }, \
+    {    3645,  -13364,   69250 }, \
+}
+
+// linear RGB -> XYZ, Q16
+#define HW_LIGHT_RGB_TO_XYZ { \
+    {   27026,   23440,   11831 }, \
+    {   13936,   46880,    4733 }, \
+    {    1267,    7813,   62312 }, \
+}
+
+#define HW_LIGHT_PACK16(lo, hi) ( (uint32_t) (uint16_t) (lo) | ((uint32_t) (uint16_t) (hi) << 16) )
+
+// XYZ -> linear RGB, Q13 coefficient pairs { c0 | c1 << 16, c2 }
+#define HW_LIGHT_XYZ_TO_RGB_DUAL_Q 13
+#define HW_LIGHT_XYZ_TO_RGB_DUAL { \
+    { HW_LIGHT_PACK16(  26550, -12594 ), HW_LIGHT_PACK16(  -4085, 0 ) }, \
+    { HW_LIGHT_PACK16(  -7938,  15364 ), HW_LIGHT_PACK16(    340, 0 ) }, \
+    { HW_LIGHT_PACK16(    456,  -1670 ), HW_LIGHT_PACK16(   8656, 0 ) }, \
+}
+
+// linear RGB -> XYZ, Q15 coefficient pairs { c0 | c1 << 16, c2 }
+#define HW_LIGHT_RGB_TO_XYZ_DUAL_Q 15
+#define HW_LIGHT_RGB_TO_XYZ_DUAL { \
+    { HW_LIGHT_PACK16(  13513,  11720 ), HW_LIGHT_PACK16(   5916, 0 ) }, \
+    { HW_LIGHT_PACK16(   6968,  23440 ), HW_LIGHT_PACK16(   2366, 0 ) }, \
+    { HW_LIGHT_PACK16(    633,   3907 ), HW_LIGHT_PACK16(  31156, 0 ) }, \
+}
+
+#endif // HW_LIGHT_COLOR_CALIBRATION_H
@@ -0,0 +1,83 @@
+/***************************************************************************//**
+ * @brief MLight hardware light driver configuration header.
+ ******************************************************************************/
+
+#ifndef HW_LIGHT_CONFIG_H
+#define HW_LIGHT_CONFIG_H
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <h>Temporal dithering
+
+// <q HW_LIGHT_DITHERING_ENABLE> Enable temporal dithering of low PWM duties
+// <i> Default: 0
+// <i> Alternates between adjacent PWM duty values to hit the fractional duty of the
+// <i> 16-bit channel intensity. Only runs while a channel is below the dithering threshold.
+// <i> LDMA writes the duty of every PWM period on the timer overflow, it takes a DMA
+// <i> channel per light channel, shared with the hardware fades.
+#define HW_LIGHT_DITHERING_ENABLE   0
+
+// <o HW_LIGHT_DITHER_MIN_HZ> Lowest frequency the dithering adds, Hz <125-4096>
+// <i> Default: 1250
+// <i> The dithering pattern repeats at least this often, at 1250 Hz even a full on-off
+// <i> modulation stays in the IEEE 1789 low risk range. The duty step is split into
+// <i> PWM frequency / this many parts, rounded down to a power of two, up to 32.
+#define HW_LIGHT_DITHER_MIN_HZ   1250
+
+// <o HW_LIGHT_DITHER_MAX_DUTY_PERCENT> Dither channels below this duty, % <1-100>
+// <i> Default: 5
+// <i> Above it the steps between adjacent PWM duties are not visible and dithering is not worth the wakeups.
+#define HW_LIGHT_DITHER_MAX_DUTY_PERCENT   5
+
+// </h>
+
+// <h>Dimming
+
+// <o HW_LIGHT_DIMMING_CURVE> CurrentLevel to channel intensity curve
+// <DIMMING_CURVE_LINEAR=> Linear
+// <DIMMING_CURVE_CIE_LIGHTNESS=> CIE lightness (perceptual)
+// <i> Default: DIMMING_CURVE_LINEAR
+// <i> CIE lightness makes each level step a visually even step, most of the linear
+// <i> curve's perceived range is in the bottom levels.
+#define HW_LIGHT_DIMMING_CURVE   DIMMING_CURVE_LINEAR
+
+// </h>
+
+// <h>Hardware fades
+
+// <q HW_LIGHT_LDMA_FADE_ENABLE> Run channel level transitions on LDMA
+// <i> Default: 0
+// <i> LDMA streams a precomputed table of compare values into the PWM TIMER, one
+// <i> write per PWM period, so the CPU isn't woken up for every level step of a fade.
+#define HW_LIGHT_LDMA_FADE_ENABLE   0
+
+// <o HW_LIGHT_LDMA_FADE_STEPS> Steps per fade <8-64>
+// <i> Default: 32
+// <i> Each step takes 20 bytes of RAM per channel.
+#define HW_LIGHT_LDMA_FADE_STEPS   32
+
+// <o HW_LIGHT_LDMA_FADE_MIN_MS> Shortest transition faded in hardware, ms <0-10000>
+// <i> Default: 200
+// <i> Shorter transitions take only a few frames and stay in software.
+#define HW_LIGHT_LDMA_FADE_MIN_MS   200
+
+// </h>
+
+// <h>Trace
+
+// <q HW_LIGHT_TRACE_ENABLE> Enable the light pipeline binary trace
+// <i> Default: 0
+// <i> Records commands, attribute changes, renders and PWM writes into a RAM ring,
+// <i> drained with the "light_trace" CLI command and decoded by tools/light_trace_decode.py
+#define HW_LIGHT_TRACE_ENABLE   0
+
+// <o HW_LIGHT_TRACE_RECORDS> Trace ring size, records <16-1024>
+// <i> Default: 128
+// <i> Each record takes 8 bytes of RAM, the oldest records are overwritten.
+#define HW_LIGHT_TRACE_RECORDS   128
+
+// </h>
+
+// <<< end of configuration section >>>
+
+#endif // HW_LIGHT_CONFIG_H
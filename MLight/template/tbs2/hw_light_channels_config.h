@@ -0,0 +1,133 @@
+/***************************************************************************//**
+ * @brief MLight light channel layout, Thunderboard Sense 2.
+ ******************************************************************************/
+
+#ifndef HW_LIGHT_CHANNELS_CONFIG_H
+#define HW_LIGHT_CHANNELS_CONFIG_H
+
+// <<< Use Configuration Wizard in Context Menu >>>
+
+// <h>Channel layout
+
+// <o HW_LIGHT_WHITE_CHANNELS> White channels next to the RGB LED
+// <0=> RGB
+// <1=> RGBW
+// <2=> RGBWW
+// <i> Default: 0
+// <i> The common part of red, green and blue is moved onto the white emitters,
+// <i> the first one takes as much as it can, the second one the rest.
+// <i> White channels use the PWM frequency and resolution of the RGB LED.
+// <i> Hardware fades are not available with white channels.
+#define HW_LIGHT_WHITE_CHANNELS   0
+
+// </h>
+
+// <h>White
+
+// <o HW_LIGHT_WHITE_POLARITY> Polarity
+// <SL_SIMPLE_RGB_PWM_LED_POLARITY_ACTIVE_LOW=> Active low
+// <SL_SIMPLE_RGB_PWM_LED_POLARITY_ACTIVE_HIGH=> Active high
+// <i> Default: SL_SIMPLE_RGB_PWM_LED_POLARITY_ACTIVE_HIGH
+#define HW_LIGHT_WHITE_POLARITY   SL_SIMPLE_RGB_PWM_LED_POLARITY_ACTIVE_HIGH
+
+// <o HW_LIGHT_WHITE_RED> Red content, per mille of the red channel <0-1000>
+// <i> Default: 1000
+// <i> How much of each color channel at full intensity the white emitter at full
+// <i> intensity reproduces, 1000/1000/1000 for a white balanced to the RGB LED.
+#define HW_LIGHT_WHITE_RED   1000
+
+// <o HW_LIGHT_WHITE_GREEN> Green content, per mille of the green channel <0-1000>
+// <i> Default: 1000
+#define HW_LIGHT_WHITE_GREEN   1000
+
+// <o HW_LIGHT_WHITE_BLUE> Blue content, per mille of the blue channel <0-1000>
+// <i> Default: 1000
+#define HW_LIGHT_WHITE_BLUE   1000
+
+// </h>
+
+// <h>Warm white
+
+// <o HW_LIGHT_WARM_WHITE_POLARITY> Polarity
+// <SL_SIMPLE_RGB_PWM_LED_POLARITY_ACTIVE_LOW=> Active low
+// <SL_SIMPLE_RGB_PWM_LED_POLARITY_ACTIVE_HIGH=> Active high
+// <i> Default: SL_SIMPLE_RGB_PWM_LED_POLARITY_ACTIVE_HIGH
+#define HW_LIGHT_WARM_WHITE_POLARITY   SL_SIMPLE_RGB_PWM_LED_POLARITY_ACTIVE_HIGH
+
+// <o HW_LIGHT_WARM_WHITE_RED> Red content, per mille of the red channel <0-1000>
+// <i> Default: 1000
+#define HW_LIGHT_WARM_WHITE_RED   1000
+
+// <o HW_LIGHT_WARM_WHITE_GREEN> Green content, per mille of the green channel <0-1000>
+// <i> Default: 700
+#define HW_LIGHT_WARM_WHITE_GREEN   700
+
+// <o HW_LIGHT_WARM_WHITE_BLUE> Blue content, per mille of the blue channel <0-1000>
+// <i> Default: 350
+#define HW_LIGHT_WARM_WHITE_BLUE   350
+
+// </h>
+
+// <h>Channel currents
+// <i> LED current of each channel at full intensity, the mixing compares channel
+// <i> combinations by the current they draw.
+
+// <o HW_LIGHT_RED_CURRENT_MA> Red, mA <0-1000>
+// <i> Default: 20
+#define HW_LIGHT_RED_CURRENT_MA   20
+
+// <o HW_LIGHT_GREEN_CURRENT_MA> Green, mA <0-1000>
+// <i> Default: 20
+#define HW_LIGHT_GREEN_CURRENT_MA   20
+
+// <o HW_LIGHT_BLUE_CURRENT_MA> Blue, mA <0-1000>
+// <i> Default: 20
+#define HW_LIGHT_BLUE_CURRENT_MA   20
+
+// <o HW_LIGHT_WHITE_CURRENT_MA> White, mA <0-1000>
+// <i> Default: 20
+// <i> A white is only used while it draws less than the color channels it replaces.
+#define HW_LIGHT_WHITE_CURRENT_MA   20
+
+// <o HW_LIGHT_WARM_WHITE_CURRENT_MA> Warm white, mA <0-1000>
+// <i> Default: 20
+#define HW_LIGHT_WARM_WHITE_CURRENT_MA   20
+
+// </h>
+
+// <h>Mixing
+
+// <q HW_LIGHT_MIX_POWER_OPTIMAL> Render the color light at the lowest current
+// <i> Default: 0
+// <i> Picks the chromaticity within the tolerance of the requested one which the
+// <i> channels reproduce at the lowest current, the luminance is kept.
+#define HW_LIGHT_MIX_POWER_OPTIMAL   1
+
+// <o HW_LIGHT_MIX_XY_TOLERANCE> Chromaticity tolerance, xy * 65536 <0-1000>
+// <i> Default: 200
+// <i> About 3 MacAdam steps, not noticeable next to the requested color.
+#define HW_LIGHT_MIX_XY_TOLERANCE   200
+
+// </h>
+
+// <<< end of configuration section >>>
+
+// The board has no white LEDs, the pins below are placeholders for a fixture.
+// <<< sl:start pin_tool >>>
+// <timer channel=WHITE,WARM_WHITE> HW_LIGHT
+// $[TIMER_HW_LIGHT]
+#define HW_LIGHT_WHITE_PERIPHERAL   TIMER1
+#define HW_LIGHT_WHITE_CHANNEL      0
+#define HW_LIGHT_WHITE_PORT         gpioPortA
+#define HW_LIGHT_WHITE_PIN          0
+#define HW_LIGHT_WHITE_LOC          0
+
+#define HW_LIGHT_WARM_WHITE_PERIPHERAL   TIMER1
+#define HW_LIGHT_WARM_WHITE_CHANNEL      1
+#define HW_LIGHT_WARM_WHITE_PORT         gpioPortA
+#define HW_LIGHT_WARM_WHITE_PIN          1
+#define HW_LIGHT_WARM_WHITE_LOC          0
+// [TIMER_HW_LIGHT]$
+// <<< sl:end pin_tool >>>
+
+#endif // HW_LIGHT_CHANNELS_CONFIG_H
@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""
+Host-side accuracy check and benchmark of the fixed point color conversion.
+
+Builds MLight/light/color_conv.c and gamma.c with the calibration of a board
+template and a small harness with the host C compiler, then:
+
+- sweeps x, y in 1/256 steps inside the unit triangle and every level 0..255
+  through color_conv_xy_to_rgb() and the float/pow() path it replaced, run on
+  the same calibration matrix, and reports the worst channel error and the
+  share of bit exact outputs
+- times both xy -> RGB paths, the HSV and RGB -> xy conversions and the matrix
+  kernels of color_conv_benchmark(), in ns per conversion
+
+The packed kernels run on their C equivalent on the host, the SMLAD figures
+only come from the target ("color_bench" CLI command). Run after changing
+color_conv.c, gamma.c or a calibration:
+
+    python3 tools/color_conv_bench.py [board]
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+
+MLIGHT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "MLight")
+LIGHT_DIR = os.path.join(MLIGHT_DIR, "light")
+TEMPLATE_DIR = os.path.join(MLIGHT_DIR, "template")
+
+DEFAULT_BOARD = "tbs2"
+# worst case error allowed against the float path, 1 LSB of an 8-bit channel, see color_conv.h
+MAX_ERROR = 257
+# conversions per timed run
+BENCHMARK_ROUNDS = 2000000
+
+HARNESS = r"""
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "color_conv.h"
+#include "hw_light_color_calibration.h"
+
+static const int32_t xyz_to_rgb[3][3] = HW_LIGHT_XYZ_TO_RGB;
+
+static uint32_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t) ((uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static double srgb_encode(double linear)
+{
+    if (linear <= 0.0031308) return 12.92 * linear;
+    return 1.055 * pow(linear, 1.0 / 2.4) - 0.055;
+}
+
+// the float path color_conv_xy_to_rgb() replaced
+static void reference_xy_to_rgb(uint16_t color_x, uint16_t color_y, uint8_t level,
+                                uint16_t *red, uint16_t *green, uint16_t *blue)
+{
+    float x = color_x / 65535.0f;
+    float y = color_y / 65535.0f;
+    float Y = level / 255.0f;
+    float xyz[3] = { (Y / y) * x, Y, (Y / y) * (1.0f - x - y) };
+    uint16_t *out[3] = { red, green, blue };
+
+    for (int c = 0; c < 3; c++) {
+        float linear = 0;
+        for (int i = 0; i < 3; i++) linear += xyz[i] * (xyz_to_rgb[c][i] / 65536.0f);
+        float encoded = (float) srgb_encode(linear < 0 ? 0 : linear);
+        if (encoded > 1) encoded = 1;
+        *out[c] = (uint16_t) lround(65535.0f * encoded * Y);
+    }
+}
+
+static double per_conversion_ns(uint32_t start, uint32_t rounds)
+{
+    return (double) (uint32_t) (now_ns() - start) / rounds;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t max_error = (uint32_t) atol(argv[1]);
+    uint32_t rounds = (uint32_t) atol(argv[2]);
+    uint32_t worst = 0, worst_x = 0, worst_y = 0, worst_level = 0;
+    unsigned long count = 0, exact = 0;
+    (void) argc;
+
+    for (uint32_t x = 0; x <= 0xFFFF; x += 256) {
+        for (uint32_t y = 256; y <= 0xFFFF - x; y += 256) {
+            for (uint32_t level = 0; level <= 255; level++) {
+                uint16_t ref[3], fix[3];
+                uint32_t error = 0;
+                reference_xy_to_rgb(x, y, level, &ref[0], &ref[1], &ref[2]);
+                color_conv_xy_to_rgb(x, y, level, &fix[0], &fix[1], &fix[2]);
+                for (int c = 0; c < 3; c++) {
+                    uint32_t d = (uint32_t) abs((int) ref[c] - (int) fix[c]);
+                    if (d > error) error = d;
+                }
+                count++;
+                exact += (0 == error);
+                if (error > worst) {
+                    worst = error;
+                    worst_x = x;
+                    worst_y = y;
+                    worst_level = level;
+                }
+            }
+        }
+    }
+    printf("xy -> RGB: %lu conversions, %.1f%% bit exact, worst %u/65535 at x %u y %u level %u\n",
+           count, 100.0 * exact / count, worst, worst_x, worst_y, worst_level);
+
+    volatile uint32_t sink = 0;
+    uint16_t r, g, b, cx, cy;
+    uint8_t level;
+    uint32_t start;
+
+    start = now_ns();
+    for (uint32_t i = 0; i < rounds; i++) {
+        reference_xy_to_rgb((i * 37) & 0x7FFF, 0x4000 + (i & 0x3FFF), i & 0xFF, &r, &g, &b);
+        sink += r + g + b;
+    }
+    printf("xy -> RGB float: %.1f ns\n", per_conversion_ns(start, rounds));
+
+    start = now_ns();
+    for (uint32_t i = 0; i < rounds; i++) {
+        color_conv_xy_to_rgb((i * 37) & 0x7FFF, 0x4000 + (i & 0x3FFF), i & 0xFF, &r, &g, &b);
+        sink += r + g + b;
+    }
+    printf("xy -> RGB fixed: %.1f ns\n", per_conversion_ns(start, rounds));
+
+    start = now_ns();
+    for (uint32_t i = 0; i < rounds; i++) {
+        color_conv_hsv_to_rgb((uint16_t) (i * 2053), i % 255, i & 0xFF, &r, &g, &b);
+        sink += r + g + b;
+    }
+    printf("HSV -> RGB fixed: %.1f ns\n", per_conversion_ns(start, rounds));
+
+    start = now_ns();
+    for (uint32_t i = 0; i < rounds; i++) {
+        cx = cy = 0;
+        color_conv_rgb_to_xy(i & 0xFF, (i >> 8) & 0xFF, (i * 7) & 0xFF, &cx, &cy, &level);
+        sink += cx + cy + level;
+    }
+    printf("RGB -> xy fixed: %.1f ns\n", per_conversion_ns(start, rounds));
+
+    color_conv_benchmark_t result;
+    color_conv_benchmark(now_ns, &result);
+    printf("kernels (%s): XYZ -> RGB wide %u packed %u, RGB -> XYZ wide %u packed %u ns\n",
+           result.backend, result.xyz_to_rgb_wide, result.xyz_to_rgb_packed,
+           result.rgb_to_xyz_wide, result.rgb_to_xyz_packed);
+
+    (void) sink;
+    return worst > max_error;
+}
+"""
+
+
+def build_harness(workdir, board):
+    harness = os.path.join(workdir, "harness.c")
+    binary = os.path.join(workdir, "color_conv_bench")
+    with open(harness, "w") as f:
+        f.write(HARNESS)
+    subprocess.check_call([os.environ.get("CC", "cc"), "-O2", "-Wall", "-Werror",
+                           "-I", LIGHT_DIR, "-I", os.path.join(TEMPLATE_DIR, board),
+                           "-o", binary, harness,
+                           os.path.join(LIGHT_DIR, "color_conv.c"),
+                           os.path.join(LIGHT_DIR, "gamma.c"), "-lm"])
+    return binary
+
+
+def main():
+    board = sys.argv[1] if len(sys.argv) > 1 else DEFAULT_BOARD
+    if not os.path.isfile(os.path.join(TEMPLATE_DIR, board, "hw_light_color_calibration.h")):
+        print("no color calibration in template/%s" % board)
+        return 1
+    with tempfile.TemporaryDirectory() as workdir:
+        binary = build_harness(workdir, board)
+        status = subprocess.call([binary, str(MAX_ERROR), str(BENCHMARK_ROUNDS)])
+        if status:
+            print("worst error above %d/65535" % MAX_ERROR)
+        return status
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""
+Host-side model of the temporal dithering of the light channels.
+
+Builds MLight/light/dither.c with the host C compiler, generates the duty pattern
+of every dithered intensity through it and replays it against a model of the
+looping LDMA descriptor and the buffered TIMER compare register:
+
+- the descriptor writes the next pattern duty into the compare buffer on each
+  TIMER overflow and links back to itself at the end of the pattern
+- the buffer is loaded into the compare register on the next overflow, so the
+  duty written on overflow n drives PWM period n + 1
+
+Every pattern of the sweep is checked for the duties it uses, its average duty
+against the exact duty of the intensity and its lowest frequency content, which
+must not be below the configured minimum. Run after changing dither.c:
+
+    python3 tools/dither_model.py
+"""
+
+import cmath
+import ctypes
+import os
+import subprocess
+import sys
+import tempfile
+
+LIGHT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "MLight", "light")
+
+# keep in sync with dither.h and hw_light_config.h
+DITHER_PATTERN_MAX_BITS = 5
+HW_LIGHT_INTENSITY_MAX = 0xFFFF
+HW_LIGHT_DITHER_MAX_DUTY_PERCENT = 5
+
+# PWM setups to sweep: (PWM frequency, PWM resolution)
+PWM_SETUPS = [(10000, 1024), (10000, 256), (5000, 1024), (20000, 4096), (40000, 256)]
+MIN_FREQUENCIES = [500, 1250, 2000]
+# replayed pattern repetitions, the spectrum resolution is a fraction of the pattern rate
+REPETITIONS = 4
+# spectral content below this part of a duty step counts as none
+SPECTRUM_FLOOR = 1e-9
+
+
+def build_library(workdir):
+    source = os.path.join(LIGHT_DIR, "dither.c")
+    library = os.path.join(workdir, "dither.so")
+    subprocess.check_call([os.environ.get("CC", "cc"), "-O2", "-Wall", "-Werror", "-shared",
+                           "-fPIC", "-I", LIGHT_DIR, "-o", library, source])
+    lib = ctypes.CDLL(library)
+    lib.dither_pattern_bits.restype = ctypes.c_uint8
+    lib.dither_pattern_bits.argtypes = [ctypes.c_uint32, ctypes.c_uint32]
+    lib.dither_pattern_build.restype = ctypes.c_uint16
+    lib.dither_pattern_build.argtypes = [ctypes.c_uint16, ctypes.c_uint16, ctypes.c_uint16,
+                                         ctypes.c_uint8, ctypes.POINTER(ctypes.c_uint32)]
+    return lib
+
+
+def replay(pattern, start, periods):
+    """Duty of every PWM period, period 0 being the one the dithering starts in."""
+    duty, buffer = start, start
+    trace = []
+    for n in range(periods):
+        trace.append(duty)
+        # overflow: the buffer is loaded first, then LDMA writes the next pattern duty
+        duty = buffer
+        buffer = pattern[n % len(pattern)]
+    return trace
+
+
+def lowest_frequency(trace, frequency, min_frequency):
+    """Lowest frequency with content in the steady part of the trace, None if none below min_frequency."""
+    count = len(trace)
+    mean = sum(trace) / count
+    for k in range(1, count // 2 + 1):
+        bin_frequency = k * frequency / count
+        if bin_frequency >= min_frequency:
+            return None
+        amplitude = abs(sum((d - mean) * cmath.exp(-2j * cmath.pi * k * n / count)
+                            for n, d in enumerate(trace))) / count
+        if amplitude > SPECTRUM_FLOOR:
+            return bin_frequency
+    return None
+
+
+def check_bits(lib, frequency, min_frequency):
+    bits = lib.dither_pattern_bits(frequency, min_frequency)
+    errors = []
+    if bits > DITHER_PATTERN_MAX_BITS:
+        errors.append("%d pattern bits" % bits)
+    if bits and frequency >> bits < min_frequency:
+        errors.append("a %d period pattern repeats below %d Hz" % (1 << bits, min_frequency))
+    if bits < DITHER_PATTERN_MAX_BITS and frequency >> (bits + 1) >= min_frequency:
+        errors.append("%d pattern bits where %d fit" % (bits, bits + 1))
+    return bits, errors
+
+
+def check(lib, frequency, resolution, min_frequency, bits, intensity):
+    """Return a list of problems with the pattern of the intensity and whether it is dithered."""
+    max_duty = resolution - 1
+    length = 1 << bits
+    pattern = (ctypes.c_uint32 * length)()
+    count = lib.dither_pattern_build(intensity, HW_LIGHT_INTENSITY_MAX, max_duty, bits, pattern)
+    exact = intensity * max_duty / HW_LIGHT_INTENSITY_MAX
+    duty = intensity * max_duty // HW_LIGHT_INTENSITY_MAX
+    tolerance = 1 / (2 * length) + 1e-9
+
+    if count == 0:
+        # left to the rounded duty, which must be as close as the pattern would get
+        if abs(round(exact) - exact) > tolerance:
+            return ["not dithered, %.4f off the exact duty" % abs(round(exact) - exact)], False
+        return [], False
+
+    errors = []
+    if count != length:
+        return ["pattern of %d periods instead of %d" % (count, length)], True
+    if any(d not in (duty, duty + 1) for d in pattern):
+        errors.append("duties %s outside %d-%d" % (sorted(set(pattern)), duty, duty + 1))
+
+    # the first period still runs the duty written before, the second one is loaded by the
+    # overflow the descriptor starts on, the pattern drives the output from the third one on
+    trace = replay(list(pattern), duty, 2 + REPETITIONS * length)[2:]
+    average = sum(trace) / len(trace)
+    if abs(average - exact) > tolerance:
+        errors.append("average duty %.4f, exact %.4f" % (average, exact))
+    lowest = lowest_frequency(trace, frequency, min_frequency)
+    if lowest is not None:
+        errors.append("content at %.1f Hz" % lowest)
+    return errors, True
+
+
+def main():
+    with tempfile.TemporaryDirectory() as workdir:
+        lib = build_library(workdir)
+        checked = dithered = failed = 0
+        for frequency, resolution in PWM_SETUPS:
+            for min_frequency in MIN_FREQUENCIES:
+                bits, errors = check_bits(lib, frequency, min_frequency)
+                if errors:
+                    failed += 1
+                    print("%d Hz, min %d Hz: %s" % (frequency, min_frequency, "; ".join(errors)))
+                if not bits:
+                    continue
+                # every intensity up to the dithering threshold
+                top = (resolution - 1) * HW_LIGHT_DITHER_MAX_DUTY_PERCENT // 100
+                last = (top * HW_LIGHT_INTENSITY_MAX + resolution - 2) // (resolution - 1)
+                for intensity in range(0, min(last, HW_LIGHT_INTENSITY_MAX) + 1):
+                    errors, was_dithered = check(lib, frequency, resolution, min_frequency,
+                                                 bits, intensity)
+                    checked += 1
+                    dithered += was_dithered
+                    if errors:
+                        failed += 1
+                        print("%d Hz, resolution %d, min %d Hz, intensity %d: %s" % (
+                            frequency, resolution, min_frequency, intensity, "; ".join(errors)))
+        print("%d intensities checked, %d dithered, %d failed" % (checked, dithered, failed))
+        return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
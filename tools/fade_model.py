@@ -0,0 +1,133 @@
+#!/usr/bin/env python3
+"""
+Host-side register model of the LDMA light fades.
+
+Builds MLight/light/fade_table.c with the host C compiler, generates step
+tables through it and replays them against a model of the LDMA descriptor
+chain and the buffered TIMER compare register:
+
+- every descriptor writes its compare value into the compare buffer on each
+  TIMER overflow, for as many overflows as the step lasts
+- the buffer is loaded into the compare register on the next overflow, so the
+  value written on overflow n drives PWM period n + 1
+
+Every table of the sweep is checked for the total duration, the final compare
+value, monotonic progress and the distance from the ideal linear ramp. Run
+after changing fade_table.c:
+
+    python3 tools/fade_model.py
+"""
+
+import ctypes
+import os
+import subprocess
+import sys
+import tempfile
+
+LIGHT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "MLight", "light")
+
+# keep in sync with fade_table.h
+FADE_TABLE_MAX_STEP_PERIODS = 2048
+
+# PWM setups to sweep: (PWM frequency, TIMER top value)
+PWM_SETUPS = [(10000, 3839), (10000, 7999), (1000, 38399)]
+DURATIONS_MS = [200, 500, 1000, 2000, 4000, 6000, 10000]
+STEP_COUNTS = [8, 32, 64]
+COMPARE_FRACTIONS = [0.0, 0.001, 0.02, 0.25, 0.5, 0.9, 1.0]
+
+
+class FadeStep(ctypes.Structure):
+    _fields_ = [("compare", ctypes.c_uint32), ("periods", ctypes.c_uint16)]
+
+
+def build_library(workdir):
+    source = os.path.join(LIGHT_DIR, "fade_table.c")
+    library = os.path.join(workdir, "fade_table.so")
+    subprocess.check_call([os.environ.get("CC", "cc"), "-O2", "-Wall", "-Werror", "-shared",
+                           "-fPIC", "-I", LIGHT_DIR, "-o", library, source])
+    lib = ctypes.CDLL(library)
+    lib.fade_table_build.restype = ctypes.c_uint8
+    lib.fade_table_build.argtypes = [ctypes.c_uint32, ctypes.c_uint32, ctypes.c_uint32,
+                                     ctypes.POINTER(FadeStep), ctypes.c_uint8]
+    return lib
+
+
+def replay(steps, start):
+    """Compare register value of every PWM period, period 0 being the one the fade starts in."""
+    compare, buffer = start, start
+    trace = [compare]
+    for step in steps:
+        for _ in range(step.periods):
+            # overflow: the buffer is loaded first, then LDMA writes the next value
+            compare = buffer
+            buffer = step.compare
+            trace.append(compare)
+    trace.append(buffer)
+    return trace
+
+
+def check(lib, top, start, target, periods, max_steps):
+    """Return a list of problems with the fade, None if the fade is not done in hardware."""
+    table = (FadeStep * max_steps)()
+    count = lib.fade_table_build(start, target, periods, table, max_steps)
+    if count == 0:
+        if (periods + max_steps - 1) // max_steps <= FADE_TABLE_MAX_STEP_PERIODS:
+            return ["rejected a fade that fits"]
+        return None
+
+    steps = table[:count]
+    errors = []
+    if count > max_steps:
+        errors.append("%d steps in a table of %d" % (count, max_steps))
+    if sum(s.periods for s in steps) != periods:
+        errors.append("lasts %d periods instead of %d" % (sum(s.periods for s in steps), periods))
+    if any(s.periods < 1 or s.periods > FADE_TABLE_MAX_STEP_PERIODS for s in steps):
+        errors.append("step length out of the LDMA transfer count range")
+    if any(s.compare > top for s in steps):
+        errors.append("compare value above TOP")
+
+    trace = replay(steps, start)
+    if trace[-1] != target:
+        errors.append("ends at %d instead of %d" % (trace[-1], target))
+    direction = 1 if target >= start else -1
+    if any((b - a) * direction < 0 for a, b in zip(trace, trace[1:])):
+        errors.append("not monotonic")
+
+    # the hardware runs one period behind the ideal ramp, a step is the allowed error
+    distance = abs(target - start)
+    tolerance = distance // count + 1
+    for n, value in enumerate(trace):
+        ideal = start + direction * distance * min(max(n - 1, 0), periods) / periods
+        if abs(value - ideal) > tolerance:
+            errors.append("period %d: %d is %.1f off the ramp" % (n, value, abs(value - ideal)))
+            break
+    return errors
+
+
+def main():
+    with tempfile.TemporaryDirectory() as workdir:
+        lib = build_library(workdir)
+        checked = rejected = failed = 0
+        for frequency, top in PWM_SETUPS:
+            compares = sorted(set(int(top * f) for f in COMPARE_FRACTIONS))
+            for duration_ms in DURATIONS_MS:
+                periods = duration_ms * frequency // 1000
+                for max_steps in STEP_COUNTS:
+                    for start in compares:
+                        for target in compares:
+                            errors = check(lib, top, start, target, periods, max_steps)
+                            if errors is None:
+                                rejected += 1
+                                continue
+                            checked += 1
+                            if errors:
+                                failed += 1
+                                print("%d Hz top %d, %d ms, %d steps, %d -> %d: %s" % (
+                                    frequency, top, duration_ms, max_steps, start, target,
+                                    "; ".join(errors)))
+        print("%d fades checked, %d too long for the table, %d failed" % (checked, rejected, failed))
+        return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
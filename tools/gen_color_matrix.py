@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+Generate the fixed point color conversion matrices of every board.
+
+Each board template has a light_calibration.json with the measured LED
+primaries, the white point of the light and the maximum luminous flux of
+every channel. This builds the linear RGB -> XYZ matrix from them, inverts
+it and writes both as Q16 integers into hw_light_color_calibration.h next
+to the calibration, so color_conv renders with integer math only:
+
+    python3 tools/gen_color_matrix.py
+
+The matrices are normalized so that the white point at full level drives
+its strongest channel at full intensity.
+
+Every matrix is also written packed for the dual 16-bit MAC kernels, two
+int16 coefficients per word, in the finest Q format where the coefficients
+fit 16 bits and a row over inputs below 2^15 fits the 32-bit accumulator.
+"""
+
+import json
+import os
+
+TEMPLATE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "MLight", "template")
+CALIBRATION = "light_calibration.json"
+HEADER = "hw_light_color_calibration.h"
+CHANNELS = ("red", "green", "blue")
+
+
+def xy_to_xyz(x, y, luminance=1.0):
+    return [luminance * x / y, luminance, luminance * (1.0 - x - y) / y]
+
+
+def mat_vec(m, v):
+    return [sum(m[r][c] * v[c] for c in range(3)) for r in range(3)]
+
+
+def inverse(m):
+    (a, b, c), (d, e, f), (g, h, i) = m
+    det = a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g)
+    if abs(det) < 1e-12:
+        raise ValueError("primaries are collinear, the matrix can't be inverted")
+    return [
+        [(e * i - f * h) / det, (c * h - b * i) / det, (b * f - c * e) / det],
+        [(f * g - d * i) / det, (a * i - c * g) / det, (c * d - a * f) / det],
+        [(d * h - e * g) / det, (b * g - a * h) / det, (a * e - b * d) / det],
+    ]
+
+
+def rgb_to_xyz_matrix(calibration):
+    flux = [float(calibration["max_flux_lm"][ch]) for ch in CHANNELS]
+    total = sum(flux)
+    # every column is a primary at the share of the luminance it has at full intensity
+    columns = [xy_to_xyz(*calibration["primaries"][ch], luminance=flux[i] / total)
+               for i, ch in enumerate(CHANNELS)]
+    m = [[columns[c][r] for c in range(3)] for r in range(3)]
+
+    # scale so the white point at Y = 1 needs exactly full intensity on its strongest channel
+    white = mat_vec(inverse(m), xy_to_xyz(*calibration["white_point"]))
+    if min(white) < 0:
+        raise ValueError("white point is outside of the primaries")
+    scale = max(white)
+    return [[value * scale for value in row] for row in m]
+
+
+def q16_matrix(m):
+    return [[round(value * 0x10000) for value in row] for row in m]
+
+
+def c_matrix(name, m, comment):
+    lines = ["// %s" % comment, "#define %s { \\" % name]
+    for row in q16_matrix(m):
+        lines.append("    { %s }, \\" % ", ".join("%7d" % v for v in row))
+    lines.append("}")
+    return "\n".join(lines)
+
+
+def dual_q(m):
+    for q in range(15, 0, -1):
+        scaled = [[round(value * (1 << q)) for value in row] for row in m]
+        if all(-0x8000 <= v <= 0x7FFF for row in scaled for v in row) \
+                and all(sum(abs(v) for v in row) < 0x10000 for row in scaled):
+            return q
+    raise ValueError("coefficients too large for the dual MAC kernels")
+
+
+def c_dual_matrix(name, m, comment):
+    q = dual_q(m)
+    lines = ["// %s, Q%d coefficient pairs { c0 | c1 << 16, c2 }" % (comment, q),
+             "#define %s_Q %d" % (name, q),
+             "#define %s { \\" % name]
+    for row in m:
+        c0, c1, c2 = (round(value * (1 << q)) for value in row)
+        lines.append("    { HW_LIGHT_PACK16( %6d, %6d ), HW_LIGHT_PACK16( %6d, 0 ) }, \\" % (c0, c1, c2))
+    lines.append("}")
+    return "\n".join(lines)
+
+
+def header(board, calibration):
+    rgb_to_xyz = rgb_to_xyz_matrix(calibration)
+    xyz_to_rgb = inverse(rgb_to_xyz)
+    return "\n".join([
+        "// Generated by tools/gen_color_matrix.py from %s/%s, do not edit." % (board, CALIBRATION),
+        "#ifndef HW_LIGHT_COLOR_CALIBRATION_H",
+        "#define HW_LIGHT_COLOR_CALIBRATION_H",
+        "",
+        c_matrix("HW_LIGHT_XYZ_TO_RGB", xyz_to_rgb, "XYZ -> linear RGB, Q16"),
+        "",
+        c_matrix("HW_LIGHT_RGB_TO_XYZ", rgb_to_xyz, "linear RGB -> XYZ, Q16"),
+        "",
+        "#define HW_LIGHT_PACK16(lo, hi) ( (uint32_t) (uint16_t) (lo) | ((uint32_t) (uint16_t) (hi) << 16) )",
+        "",
+        c_dual_matrix("HW_LIGHT_XYZ_TO_RGB_DUAL", xyz_to_rgb, "XYZ -> linear RGB"),
+        "",
+        c_dual_matrix("HW_LIGHT_RGB_TO_XYZ_DUAL", rgb_to_xyz, "linear RGB -> XYZ"),
+        "",
+        "#endif // HW_LIGHT_COLOR_CALIBRATION_H",
+        "",
+    ])
+
+
+def main():
+    for board in sorted(os.listdir(TEMPLATE_DIR)):
+        path = os.path.join(TEMPLATE_DIR, board, CALIBRATION)
+        if not os.path.isfile(path):
+            continue
+        with open(path) as f:
+            calibration = json.load(f)
+        with open(os.path.join(TEMPLATE_DIR, board, HEADER), "w") as f:
+            f.write(header(board, calibration))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""
+Generate the lookup tables used by the light rendering pipeline.
+
+The firmware must not call pow()/powf() in the light hot path, so every
+transfer function is sampled here and compiled in as a const table.
+Re-run after changing any of the parameters below:
+
+    python3 tools/gen_light_tables.py
+"""
+
+import os
+
+LIGHT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "MLight", "light")
+
+# sRGB transfer function
+SRGB_A = 0.055
+SRGB_GAMMA = 2.4
+SRGB_ENCODE_THRESHOLD = 0.0031308
+SRGB_DECODE_THRESHOLD = 0.04045
+
+# linear -> sRGB table is sampled every 1/GAMMA_ENCODE_STEPS and interpolated
+GAMMA_ENCODE_STEPS = 256
+
+# CIE 1976 lightness, L* = 116 * f(Y) - 16
+CIE_KAPPA = 24389.0 / 27.0
+CIE_EPSILON_L = 8.0
+# ZCL CurrentLevel steps covered by the dimming table
+DIMMING_LEVELS = 256
+
+# Planckian locus, sampled every 2^PLANCK_STEP_SHIFT mireds from 25000K down to 1667K,
+# the range of the Kim et al. cubic spline approximation
+PLANCK_MIREDS_MIN = 40
+PLANCK_MIREDS_MAX = 600
+PLANCK_STEP_SHIFT = 4
+
+
+def srgb_encode(linear):
+    if linear <= SRGB_ENCODE_THRESHOLD:
+        return 12.92 * linear
+    return (1.0 + SRGB_A) * linear ** (1.0 / SRGB_GAMMA) - SRGB_A
+
+
+def srgb_decode(encoded):
+    if encoded <= SRGB_DECODE_THRESHOLD:
+        return encoded / 12.92
+    return ((encoded + SRGB_A) / (1.0 + SRGB_A)) ** SRGB_GAMMA
+
+
+def cie_lightness_to_luminance(lightness):
+    """L* [0-100] -> relative luminance Y [0-1]"""
+    if lightness <= CIE_EPSILON_L:
+        return lightness / CIE_KAPPA
+    return ((lightness + 16.0) / 116.0) ** 3
+
+
+def planck_locus(kelvin):
+    """CIE 1931 xy of a black body, Kim et al. cubic spline [1667K-25000K]"""
+    t = float(kelvin)
+    if t <= 4000:
+        x = -0.2661239e9 / t ** 3 - 0.2343589e6 / t ** 2 + 0.8776956e3 / t + 0.179910
+    else:
+        x = -3.0258469e9 / t ** 3 + 2.1070379e6 / t ** 2 + 0.2226347e3 / t + 0.240390
+    if t <= 2222:
+        y = -1.1063814 * x ** 3 - 1.34811020 * x ** 2 + 2.18555832 * x - 0.20219683
+    elif t <= 4000:
+        y = -0.9549476 * x ** 3 - 1.37418593 * x ** 2 + 2.09137015 * x - 0.16748867
+    else:
+        y = 3.0817580 * x ** 3 - 5.87338670 * x ** 2 + 3.75112997 * x - 0.37001483
+    return x, y
+
+
+def q16(value):
+    return min(0xFFFF, max(0, round(value * 0xFFFF)))
+
+
+def c_array(ctype, name, values, per_line=10):
+    lines = ["static const %s %s[%d] = {" % (ctype, name, len(values))]
+    for i in range(0, len(values), per_line):
+        chunk = values[i:i + per_line]
+        lines.append("    " + ", ".join("%5d" % v for v in chunk) + ",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def gamma_tables():
+    encode = [q16(srgb_encode(i / GAMMA_ENCODE_STEPS)) for i in range(GAMMA_ENCODE_STEPS + 1)]
+    decode = [q16(srgb_decode(i / 255.0)) for i in range(256)]
+    return "\n".join([
+        "// Generated by tools/gen_light_tables.py, do not edit.",
+        "#ifndef _GAMMA_TABLES_H_",
+        "#define _GAMMA_TABLES_H_",
+        "",
+        "#include <stdint.h>",
+        "",
+        "#define GAMMA_ENCODE_STEPS %d" % GAMMA_ENCODE_STEPS,
+        "",
+        "// linear -> sRGB, sampled at L = i / GAMMA_ENCODE_STEPS, 0xFFFF == 1.0",
+        c_array("uint16_t", "gamma_encode_table", encode),
+        "",
+        "// sRGB -> linear for each 8-bit sRGB code, 0xFFFF == 1.0",
+        c_array("uint16_t", "gamma_decode_table", decode),
+        "",
+        "#endif // _GAMMA_TABLES_H_",
+        "",
+    ])
+
+
+def dimming_tables():
+    top = DIMMING_LEVELS - 1
+    cie = [q16(cie_lightness_to_luminance(100.0 * i / top)) for i in range(DIMMING_LEVELS)]
+    return "\n".join([
+        "// Generated by tools/gen_light_tables.py, do not edit.",
+        "#ifndef _DIMMING_TABLES_H_",
+        "#define _DIMMING_TABLES_H_",
+        "",
+        "#include <stdint.h>",
+        "",
+        "// CurrentLevel -> channel intensity, level is taken as CIE L* = 100 * i / %d," % top,
+        "// 0xFFFF == full intensity",
+        c_array("uint16_t", "dimming_cie_lightness_table", cie),
+        "",
+        "#endif // _DIMMING_TABLES_H_",
+        "",
+    ])
+
+
+def planck_tables():
+    step = 1 << PLANCK_STEP_SHIFT
+    mireds = range(PLANCK_MIREDS_MIN, PLANCK_MIREDS_MAX + 1, step)
+    assert mireds[-1] == PLANCK_MIREDS_MAX, "mireds range must be a multiple of the step"
+    locus = [planck_locus(1e6 / m) for m in mireds]
+    return "\n".join([
+        "// Generated by tools/gen_light_tables.py, do not edit.",
+        "#ifndef _PLANCK_TABLES_H_",
+        "#define _PLANCK_TABLES_H_",
+        "",
+        "#include <stdint.h>",
+        "",
+        "#define PLANCK_MIREDS_MIN %d" % PLANCK_MIREDS_MIN,
+        "#define PLANCK_MIREDS_MAX %d" % PLANCK_MIREDS_MAX,
+        "#define PLANCK_STEP_SHIFT %d" % PLANCK_STEP_SHIFT,
+        "",
+        "// Planckian locus CIE x and y at PLANCK_MIREDS_MIN + i * 2^PLANCK_STEP_SHIFT mireds,",
+        "// as ZCL CurrentX / CurrentY (x * 65535)",
+        c_array("uint16_t", "planck_locus_x", [q16(x) for x, _ in locus]),
+        "",
+        c_array("uint16_t", "planck_locus_y", [q16(y) for _, y in locus]),
+        "",
+        "#endif // _PLANCK_TABLES_H_",
+        "",
+    ])
+
+
+def main():
+    with open(os.path.join(LIGHT_DIR, "gamma_tables.h"), "w") as f:
+        f.write(gamma_tables())
+    with open(os.path.join(LIGHT_DIR, "dimming_tables.h"), "w") as f:
+        f.write(dimming_tables())
+    with open(os.path.join(LIGHT_DIR, "planck_tables.h"), "w") as f:
+        f.write(planck_tables())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""
+Decode the light pipeline trace printed by the "light_trace" CLI command.
+
+Enable HW_LIGHT_TRACE_ENABLE in hw_light_config.h, exercise the light, run
+"light_trace" on the CLI and feed the captured console output to this script:
+
+    python3 tools/light_trace_decode.py console.log
+
+Every received ZCL command is matched with the first channel update that
+follows it, and the command to PWM latency distribution is printed. Use
+--dump to list the decoded records as well.
+"""
+
+import argparse
+import sys
+
+# keep in sync with light_trace_event_t in MLight/light/light_trace.h
+EVENTS = {
+    1: "COMMAND",
+    2: "ONOFF",
+    3: "LEVEL",
+    4: "COLOR_X",
+    5: "COLOR_Y",
+    6: "RENDER",
+    7: "RECONCILE",
+    8: "PWM",
+    9: "PWM_ONOFF",
+    10: "FRAME",
+}
+EVT_COMMAND = 1
+OUTPUT_EVENTS = (8, 9)
+
+HISTOGRAM_BUCKETS_MS = (1, 2, 5, 10, 20, 50, 100, 200, 500, 1000)
+HISTOGRAM_WIDTH = 40
+
+
+def parse(lines):
+    """Return (tick frequency, dropped count, records) from the CLI output."""
+    freq = None
+    dropped = 0
+    records = []
+    for line in lines:
+        fields = line.split()
+        # the console may prefix lines, so look for the marker anywhere
+        if "LT" not in fields:
+            continue
+        fields = fields[fields.index("LT") + 1:]
+        if not fields or fields[0] == "end":
+            continue
+        if fields[0] == "freq":
+            freq = int(fields[1])
+            dropped += int(fields[3])
+            continue
+        ticks, event, endpoint, value = (int(f) for f in fields[:4])
+        records.append((ticks, event, endpoint, value))
+    if freq is None:
+        sys.exit("no 'LT freq' header found, is this light_trace output?")
+    return freq, dropped, records
+
+
+def latencies(records, freq):
+    """Command to first channel update latency in ms, for every command that has one."""
+    result = []
+    pending = None
+    for ticks, event, _, _ in records:
+        if event == EVT_COMMAND:
+            # a command superseded before any output doesn't reach the LEDs on its own
+            pending = ticks
+        elif event in OUTPUT_EVENTS and pending is not None:
+            # sleeptimer ticks are 32 bit and wrap
+            result.append(((ticks - pending) & 0xFFFFFFFF) * 1000.0 / freq)
+            pending = None
+    return result
+
+
+def percentile(ordered, pct):
+    index = min(len(ordered) - 1, int(round(pct / 100.0 * (len(ordered) - 1))))
+    return ordered[index]
+
+
+def print_histogram(values):
+    counts = [0] * (len(HISTOGRAM_BUCKETS_MS) + 1)
+    for v in values:
+        for i, limit in enumerate(HISTOGRAM_BUCKETS_MS):
+            if v < limit:
+                counts[i] += 1
+                break
+        else:
+            counts[-1] += 1
+    peak = max(counts)
+    labels = ["< %d ms" % limit for limit in HISTOGRAM_BUCKETS_MS]
+    labels.append(">= %d ms" % HISTOGRAM_BUCKETS_MS[-1])
+    for label, count in zip(labels, counts):
+        bar = "#" * (count * HISTOGRAM_WIDTH // peak if peak else 0)
+        print("%10s %6d %s" % (label, count, bar))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("log", nargs="?", help="captured console output, stdin if omitted")
+    parser.add_argument("--dump", action="store_true", help="print the decoded records")
+    args = parser.parse_args()
+
+    if args.log:
+        with open(args.log) as f:
+            freq, dropped, records = parse(f)
+    else:
+        freq, dropped, records = parse(sys.stdin)
+
+    if args.dump and records:
+        start = records[0][0]
+        for ticks, event, endpoint, value in records:
+            print("%10.3f ms  %-10s ep %3d  %5d" % (
+                ((ticks - start) & 0xFFFFFFFF) * 1000.0 / freq,
+                EVENTS.get(event, "?%d" % event), endpoint, value))
+        print()
+
+    print("records: %d, dropped: %d" % (len(records), dropped))
+    if dropped:
+        print("warning: the ring overflowed, the oldest commands are missing")
+
+    values = sorted(latencies(records, freq))
+    if not values:
+        print("no command -> PWM pairs found")
+        return
+    print("command -> PWM latency, %d samples" % len(values))
+    print("  min %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f ms" % (
+        values[0], percentile(values, 50), percentile(values, 90),
+        percentile(values, 99), values[-1]))
+    print_histogram(values)
+
+
+if __name__ == "__main__":
+    main()